@@ -68,8 +68,9 @@ void analyze_mode(GAME *game)
 
         // Stop analysis for the commands below
 
-        analysis_game.search.abort = TRUE;
+        search_signal(SIGNAL_STOP);
         THREAD_WAIT(analysis_thread);
+        search_signal_clear(SIGNAL_STOP);
 
         if (!strcmp(analysis_command, "exit")) {
             break;
@@ -120,6 +121,8 @@ void *analysis_start(void *game)
     settings.increment_time = 0;
     settings.use_book = FALSE;
     settings.max_nodes = 0;
+    settings.search_moves_count = 0;
+    settings.mate = 0;
 
     search_run((GAME *)game, &settings);
 
@@ -45,6 +45,29 @@ extern inline int bb_last_index(U64 bb)
     return __builtin_ctzll(bb) ^ 63;
 }
 
+#if defined(USE_DISPATCH) && defined(__x86_64__) && !defined(__POPCNT__)
+//-------------------------------------------------------------------------------------------------
+//  Number of "1" bits in the bitboard. The dispatch build is compiled for any x86-64 cpu, so the
+//  popcnt instruction is used only when the cpu supports it.
+//-------------------------------------------------------------------------------------------------
+int popcnt_supported = FALSE;
+
+extern inline int bb_bit_count(U64 bb)
+{
+    if (popcnt_supported) {
+        U64 count;
+        __asm__("popcnt %1, %0" : "=r" (count) : "r" (bb));
+        return (int)count;
+    }
+    return __builtin_popcountll(bb);
+}
+
+void init_count_table(void)
+{
+    __builtin_cpu_init();
+    popcnt_supported = __builtin_cpu_supports("popcnt");
+}
+#else
 //-------------------------------------------------------------------------------------------------
 //  Number of "1" bits in the bitboard
 //-------------------------------------------------------------------------------------------------
@@ -53,10 +76,12 @@ extern inline int bb_bit_count(U64 bb)
     return __builtin_popcountll(bb);
 }
 
+void init_count_table(void){}
+#endif
+
 // Not necessary when using builtins functions.
 void init_first_index_table(void){}
 void init_last_index_table(void){}
-void init_count_table(void){}
 
 #elif defined(_WIN64) && defined(_MSC_VER)
 
@@ -178,8 +178,10 @@ void make_move(BOARD *board, MOVE move)
     board->history[board->histply].pawn_key         = board->pawn_key;
     board->history[board->histply].fifty_move_rule  = board->fifty_move_rule;
 
-    board->nnue_data[board->histply + 1].accumulator.computed = FALSE;
-    board->nnue_data[board->histply + 1].changes.count = 0;
+    // Accumulator stack: only the search needs more than MAX_PLY entries from the root.
+    if (board->nnue_ply == MAX_PLY) set_nnue_root(board);
+    board->nnue_data[board->nnue_ply + 1].accumulator.computed = FALSE;
+    board->nnue_data[board->nnue_ply + 1].changes.count = 0;
 
     // Key
     board->key ^= zk_color();
@@ -255,6 +257,12 @@ void make_move(BOARD *board, MOVE move)
         }
     }
 
+    board->key ^= zk_ks(board->side_on_move, board->state[board->side_on_move].can_castle_ks);
+    board->key ^= zk_qs(board->side_on_move, board->state[board->side_on_move].can_castle_qs);
+
+    // Key is final: load the table entry while the rest of the move and the child node setup run.
+    tt_prefetch(board->key);
+
     // fifty move rule
     if (type == MT_CAPPC || mvpc == PAWN)
         board->fifty_move_rule = 0;
@@ -263,15 +271,16 @@ void make_move(BOARD *board, MOVE move)
 
     board->ply++;
     board->histply++;
+    board->nnue_ply++;
     if (board->ply > board->selective_depth) {
         board->selective_depth = board->ply;
     }
 
-    board->key ^= zk_ks(board->side_on_move, board->state[board->side_on_move].can_castle_ks);
-    board->key ^= zk_qs(board->side_on_move, board->state[board->side_on_move].can_castle_qs);
-
     board->side_on_move = flip_color(board->side_on_move);
 
+    // Eager mode: the accumulator is updated now, evaluate only runs the network layers.
+    if (board->nnue_eager != NULL) nnue_eager_update(board);
+
     assert(zk_board_key(board) == board->key);
     assert(board_state_is_ok(board));
     assert(board->histply <= MAX_HIST);
@@ -286,6 +295,16 @@ void undo_move(BOARD *board)
 
     if (board->ply > 0) board->ply--;
     board->histply--;
+    if (board->nnue_ply > 0) {
+        board->nnue_ply--;
+    }
+    else {
+        // Before the root of the accumulator stack, the accumulator has to be refreshed.
+        board->nnue_data[0].accumulator.computed = FALSE;
+        board->nnue_data[0].changes.count = 0;
+    }
+    // Pieces restored below are recorded in the released entry, not used anymore.
+    board->nnue_data[board->nnue_ply + 1].changes.count = 0;
 
     assert(board->ply >= 0 && board->ply < MAX_PLY);
 
@@ -449,7 +468,7 @@ void move_piece(BOARD *board, int color, int type, int frsq, int tosq)
         board->pawn_key ^= zk_square(color, PAWN, frsq);
         board->pawn_key ^= zk_square(color, PAWN, tosq);
     }
-    int nnue_index = board->histply + 1;
+    int nnue_index = board->nnue_ply + 1;
     board->nnue_data[nnue_index].changes.piece[board->nnue_data[nnue_index].changes.count] = nnue_piece(color, type);
     board->nnue_data[nnue_index].changes.from[board->nnue_data[nnue_index].changes.count] = nnue_square(frsq);
     board->nnue_data[nnue_index].changes.to[board->nnue_data[nnue_index].changes.count] = nnue_square(tosq);
@@ -468,7 +487,7 @@ void set_piece(BOARD *board, int color, int type, int tosq)
     board->key ^= zk_square(color, type, tosq);
     if (type == PAWN) board->pawn_key ^= zk_square(color, PAWN, tosq);
     board->state[color].count[type]++;
-    int nnue_index = board->histply + 1;
+    int nnue_index = board->nnue_ply + 1;
     board->nnue_data[nnue_index].changes.piece[board->nnue_data[nnue_index].changes.count] = nnue_piece(color, type);
     board->nnue_data[nnue_index].changes.from[board->nnue_data[nnue_index].changes.count] = 64; // nnue hack
     board->nnue_data[nnue_index].changes.to[board->nnue_data[nnue_index].changes.count] = nnue_square(tosq);
@@ -487,7 +506,7 @@ void remove_piece(BOARD *board, int color, int type, int frsq)
     board->key ^= zk_square(color, type, frsq);
     if (type == PAWN) board->pawn_key ^= zk_square(color, PAWN, frsq);
     board->state[color].count[type]--;
-    int nnue_index = board->histply + 1;
+    int nnue_index = board->nnue_ply + 1;
     board->nnue_data[nnue_index].changes.piece[board->nnue_data[nnue_index].changes.count] = nnue_piece(color, type);
     board->nnue_data[nnue_index].changes.from[board->nnue_data[nnue_index].changes.count] = nnue_square(frsq);
     board->nnue_data[nnue_index].changes.to[board->nnue_data[nnue_index].changes.count] = 64; // nnue hack
@@ -857,6 +876,7 @@ int can_generate_castle_qs(BOARD *board, int color)
 void set_ply(BOARD *board, U16 value)
 {
     board->ply = value;
+    if (value == 0) set_nnue_root(board);
 }
 
 U16 get_ply(BOARD *board)
@@ -869,6 +889,18 @@ U16 get_history_ply(BOARD *board)
     return board->histply;
 }
 
+//-------------------------------------------------------------------------------------------------
+//  Make the current position the root of the accumulator stack (first entry). Moves before it are
+//  not used to update accumulators anymore.
+//-------------------------------------------------------------------------------------------------
+void set_nnue_root(BOARD *board)
+{
+    if (board->nnue_ply == 0) return;
+    memcpy(&board->nnue_data[0], &board->nnue_data[board->nnue_ply], sizeof(NNUE_DATA));
+    board->nnue_data[0].changes.count = 0;
+    board->nnue_ply = 0;
+}
+
 void init_seldepth(BOARD *board)
 {
     board->selective_depth = 0;
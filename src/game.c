@@ -30,7 +30,9 @@ void new_game(GAME *game, char *fen)
     memset(&game->search, 0, sizeof(SEARCH));
     memset(&game->pv_line, 0, sizeof(PV_LINE));
     memset(&game->move_order, 0, sizeof(MOVE_ORDER));
-    memset(&game->eval_table, 0, sizeof(EVAL_TABLE));
+    game->eval_cache = eval_cache_thread(0);
+    game->nnue_param = nnue_thread_param();
+    game->finny.param = NULL;
     tt_clear();
     game->is_main_thread = TRUE;
 }
@@ -50,6 +50,7 @@
 #include <assert.h>
 #include <math.h>
 #include <inttypes.h>
+#include <stddef.h>
 
 // Multi thread functions - Reference Stockfish
 #ifndef _WIN32 // Linux - Unix
@@ -60,10 +61,35 @@ typedef pthread_t THREAD_ID;
 typedef void*(*pt_start_fn)(void*);
 
 #define THREAD_CREATE(x,f,t)    pthread_create(&(x),NULL,(pt_start_fn)f,t)
+#define THREAD_CREATED(r)       ((r) == 0)
 #define THREAD_WAIT(x)          pthread_join(x, NULL)
 #define ALIGNED_ALLOC(a, s)     aligned_alloc(a, s)
 #define ALIGNED_FREE            free
 
+typedef pthread_mutex_t MUTEX;
+typedef pthread_cond_t CONDITION;
+
+#define MUTEX_INIT(x)           pthread_mutex_init(&(x), NULL)
+#define MUTEX_LOCK(x)           pthread_mutex_lock(&(x))
+#define MUTEX_UNLOCK(x)         pthread_mutex_unlock(&(x))
+#define MUTEX_DESTROY(x)        pthread_mutex_destroy(&(x))
+#define CONDITION_INIT(x)       pthread_cond_init(&(x), NULL)
+#define CONDITION_WAIT(x,m)     pthread_cond_wait(&(x), &(m))
+#define CONDITION_BROADCAST(x)  pthread_cond_broadcast(&(x))
+#define CONDITION_DESTROY(x)    pthread_cond_destroy(&(x))
+
+#include <stdatomic.h>
+
+typedef atomic_int ATOMIC_INT;
+typedef atomic_ullong ATOMIC_U64;
+
+#define ATOMIC_LOAD(x)          atomic_load_explicit(&(x), memory_order_acquire)
+#define ATOMIC_STORE(x,v)       atomic_store_explicit(&(x), v, memory_order_release)
+#define ATOMIC_OR(x,v)          atomic_fetch_or_explicit(&(x), v, memory_order_acq_rel)
+#define ATOMIC_AND(x,v)         atomic_fetch_and_explicit(&(x), v, memory_order_acq_rel)
+#define ATOMIC_LOAD64(x)        atomic_load_explicit(&(x), memory_order_relaxed)
+#define ATOMIC_STORE64(x,v)     atomic_store_explicit(&(x), v, memory_order_relaxed)
+
 #else // Windows and MinGW
 
 #define WIN32_LEAN_AND_MEAN
@@ -73,10 +99,33 @@ typedef void*(*pt_start_fn)(void*);
 typedef HANDLE THREAD_ID;
 
 #define THREAD_CREATE(x,f,t)    (x = CreateThread(NULL,0,(LPTHREAD_START_ROUTINE)f,t,0,NULL))
+#define THREAD_CREATED(r)       ((r) != NULL)
 #define THREAD_WAIT(x)          { WaitForSingleObject(x, INFINITE); CloseHandle(x); }
 #define ALIGNED_ALLOC(a, s)     _aligned_malloc(s, a)
 #define ALIGNED_FREE            _aligned_free
 
+typedef CRITICAL_SECTION MUTEX;
+typedef CONDITION_VARIABLE CONDITION;
+
+#define MUTEX_INIT(x)           InitializeCriticalSection(&(x))
+#define MUTEX_LOCK(x)           EnterCriticalSection(&(x))
+#define MUTEX_UNLOCK(x)         LeaveCriticalSection(&(x))
+#define MUTEX_DESTROY(x)        DeleteCriticalSection(&(x))
+#define CONDITION_INIT(x)       InitializeConditionVariable(&(x))
+#define CONDITION_WAIT(x,m)     SleepConditionVariableCS(&(x), &(m), INFINITE)
+#define CONDITION_BROADCAST(x)  WakeAllConditionVariable(&(x))
+#define CONDITION_DESTROY(x)    
+
+typedef volatile LONG ATOMIC_INT;
+typedef volatile LONG64 ATOMIC_U64;
+
+#define ATOMIC_LOAD(x)          InterlockedOr(&(x), 0)
+#define ATOMIC_STORE(x,v)       InterlockedExchange(&(x), v)
+#define ATOMIC_OR(x,v)          InterlockedOr(&(x), v)
+#define ATOMIC_AND(x,v)         InterlockedAnd(&(x), v)
+#define ATOMIC_LOAD64(x)        ((U64)(x))
+#define ATOMIC_STORE64(x,v)     ((x) = (LONG64)(v))
+
 #endif
 
 // Variables are defined only once in this file.
@@ -115,6 +164,7 @@ typedef unsigned int    UINT;
 
 // Search values
 #define MAX_PLY         256
+#define MAX_MOVE        128
 #define MAX_DEPTH       120
 #define MAX_HIST       2048
 #define MAX_TIME   10000000
@@ -134,12 +184,32 @@ typedef unsigned int    UINT;
 
 #define MIN_THREADS     1
 #define MAX_THREADS     1024
+#define MAX_CPUS        4096
+#define MAX_NUMA_NODES  64
 #define MIN_HASH_SIZE   8
 #define MAX_HASH_SIZE   524288
+#define MIN_MULTI_PV    1
+#define MAX_MULTI_PV    64
 
 // Parameters
 EXTERN S32          gThreads;
 EXTERN S32          gHashSize;
+EXTERN S32          gNumaHash;
+EXTERN S32          gNumaNnue;
+EXTERN S32          gNnueEager;
+EXTERN S32          gTTStats;
+EXTERN S32          gEvalCacheSize;
+EXTERN S32          gEvalCacheShared;
+EXTERN S32          gAffinity;
+EXTERN S32          gMultiPV;
+EXTERN S32          gDebug;
+
+// Search threads cpu affinity
+#define AFFINITY_NONE       0   // threads are placed by the system
+#define AFFINITY_COMPACT    1   // fill the cpus of a numa node before using the next node
+#define AFFINITY_SCATTER    2   // alternate numa nodes
+#define AFFINITY_LIST       3   // cpus from a list, e.g. "0,2,8-15"
+#define AFFINITY_NUMA       4   // threads run on any cpu of their numa node
 
 // Piece index
 #define PAWN        0
@@ -269,6 +339,14 @@ typedef struct s_pv_line {
     int     size[MAX_PLY];
 }   PV_LINE;
 
+// Multi PV lines, sorted by score.
+typedef struct s_multi_pv {
+    MOVE    line[MAX_MULTI_PV][MAX_PLY];
+    int     size[MAX_MULTI_PV];
+    int     score[MAX_MULTI_PV];
+    int     count;
+}   MULTI_PV;
+
 // Piece Values
 #define VALUE_PAWN      180
 #define VALUE_KNIGHT    640
@@ -303,12 +381,41 @@ enum e_squares
 #define BB_FILES_QS ((U64)0xF0F0F0F0F0F0F0F0)
 #define BB_FILES_KS ((U64)0x0F0F0F0F0F0F0F0F)
 
+// Transposition table read results
+#define TT_MISS         0   // key not found, bucket has empty slots
+#define TT_HIT          1   // key found
+#define TT_MISMATCH     2   // key not found, bucket full of other keys
+
+// Transposition table save results
+#define TT_SAVE_NEW     0   // stored in empty slot
+#define TT_SAVE_UPDATE  1   // same key updated
+#define TT_SAVE_REPLACE 2   // other key replaced
+#define TT_SAVE_REJECT  3   // not stored, existing entries are more valuable
+
+// Transposition table statistics, collected per thread when gTTStats is on.
+typedef struct s_tt_stats
+{
+    U64     reads[3];               // by read result
+    U64     cutoffs[4];             // by bound type (TT_UPPER, TT_LOWER, TT_EXACT)
+    U64     saves[4];               // by save result
+    U64     eval_reads[2];          // evaluation cache reads by result (miss, hit)
+}   TT_STATS;
+
+#define TT_STATS_COUNT(game, counter, index)    { if (gTTStats) (game)->search.tt_stats.counter[index]++; }
+
 //  Search data: move, nodes, time control, etc.
 //  Times are in milliseconds.
 typedef struct s_search
 {
-    U64     nodes;                  // visited nodes
+    // Counters written at every node have their own cache line, other threads read them.
+#ifdef _MSC_VER
+    AL64 U64 nodes;                 // visited nodes
+#else
+    U64     nodes AL64;             // visited nodes
+#endif
     U64     tbhits;                 // end game table base hits
+    U64     nodes_check;            // node count for the next max_nodes check
+    char    counters_padding[40];
     int     post_flag;              // output information
     int     use_book;               // use opening book
     int     max_depth;              // max depth 
@@ -325,10 +432,19 @@ typedef struct s_search
     int     best_score;             // best move score
     MOVE    ponder_move;            // pondering move
     int     cur_depth;              // current depth
+    int     completed_depth;        // last completed iteration, best_score is its score
     int     score_drop;             // controls when score drops
     int     abort;                  // indicates end of search
+    UINT    stop_latency;           // microseconds from stop request until all threads finished
     int     root_move_count;        // number of moves at root node, used by xboard analysis
     int     root_move_search;       // number of move searched at root node, used by xboard analysis
+    int     multi_pv;               // number of principal variations to search
+    MOVE    root_exclude[MAX_MULTI_PV]; // root moves skipped, found by previous multi pv lines
+    int     root_exclude_count;
+    MOVE    search_moves[MAX_MOVE]; // root moves to search, all moves when count is 0
+    int     search_moves_count;
+    int     mate;                   // mate search: stop when mate in this number of moves is found
+    TT_STATS tt_stats;              // transposition table statistics
 #ifdef TUCANO_COMPOSITION
     MOVE    exclude;                // used for composition function, non-playing feature
 #endif
@@ -381,21 +497,26 @@ typedef struct s_board
     U64         pawn_key;
     U16         ply;
     U16         histply;
+    U16         nnue_ply;       // top of the accumulator stack
+    NNUE_PARAM  *nnue_eager;    // weights for eager accumulator updates in make_move (or NULL)
     U8          side_on_move;
     U8          fifty_move_rule;
     U8          ep_square;
     U16         selective_depth;
     MOVE_HIST   history[MAX_HIST];
-    NNUE_DATA   nnue_data[MAX_HIST];
+    NNUE_DATA   nnue_data[MAX_PLY + 1]; // accumulator stack: the root position, then one per move
 }   BOARD;
 
-typedef struct s_eval_table
+// Evaluation cache: each entry packs the upper 48 bits of the key and the score in the lower 16
+// bits, so an entry is written and read at once and the cache can be shared by threads.
+typedef struct s_eval_cache
 {
-    U64     key;
-    S32     score;
-}   EVAL_TABLE;
+    U64     *entry;
+    U64     mask;
+}   EVAL_CACHE;
 
-#define EVAL_TABLE_SIZE 64536
+#define MIN_EVAL_CACHE_SIZE     1
+#define MAX_EVAL_CACHE_SIZE     1024
 
 //  Game Data
 typedef struct s_game {
@@ -403,17 +524,19 @@ typedef struct s_game {
     BOARD       board;
     PV_LINE     pv_line;
     MOVE_ORDER  move_order;
-    EVAL_TABLE  eval_table[EVAL_TABLE_SIZE];
+    EVAL_CACHE  *eval_cache;
+    NNUE_PARAM  *nnue_param;
+    NNUE_FINNY  finny;                  // nnue refresh cache
+    MOVE        completed_pv[MAX_PLY];  // principal variation of the last completed iteration
+    int         completed_pv_size;
+    MULTI_PV    multi_pv;
     int         eval_hist[MAX_PLY];
     int         reductions[MAX_PLY];
     int         is_main_thread;
-    THREAD_ID   thread_handle;
     int         thread_number;
 }   GAME;
 
 // Move generation and selection
-#define MAX_MOVE   128
-
 typedef struct s_move_list
 {
     MOVE        moves[MAX_MOVE];
@@ -449,7 +572,10 @@ typedef union s_trans_record {
     U64 data;
 }   TT_RECORD;
 
+#define TT_EVAL_NONE    (-32768)   // no static evaluation in the entry
+
 #define TIME_CHECK  4095
+#define NODES_CHECK 1024    // max nodes between max_nodes checks
 
 // Search Reduction Table
 EXTERN int reduction_table[MAX_DEPTH][MAX_MOVE];
@@ -467,6 +593,9 @@ typedef struct s_settings {
     int     post_flag;              // post format.
     int     use_book;               // opening book use.
     U64     max_nodes;              // maximum nodes per search, 0 = no limit.
+    MOVE    search_moves[MAX_MOVE]; // root moves to search, set by searchmoves option in UCI mode.
+    int     search_moves_count;     // 0 = all moves.
+    int     mate;                   // mate search in number of moves, 0 = normal search.
 #ifdef TUCANO_COMPOSITION
     MOVE    exclude;                // used for composition functionally, non-playing.
 #endif
@@ -480,6 +609,7 @@ U64     zk_ep(int square);
 U64     zk_ks(int color, int flag);
 U64     zk_qs(int color, int flag);
 U64     zk_square(int color, int piece, int square);
+U64     zk_signature(void);
 
 // Game
 EXTERN GAME        main_game;
@@ -537,10 +667,39 @@ int     is_counter_move(MOVE_ORDER *move_order, int prev_color, MOVE previous_mo
 
 // Search
 void    prepare_search(GAME *game, SETTINGS *settings);
+// Search signals, one state shared by all threads of the running search
+#define SIGNAL_STOP     1   // search threads have to stop
+#define SIGNAL_PONDER   2   // uci: wait for ponderhit or stop when search finishes
+#define SIGNAL_INFINITE 4   // uci: wait for stop when search finishes
+
 void    threads_init(void);
+void    search_signal(int signal);
+void    search_signal_clear(int signal);
+int     search_signals(void);
+int     threads_affinity(char *policy);
+char    *threads_affinity_name(void);
+void    threads_bind(int thread_number);
 void    search_run(GAME *game, SETTINGS *settings);
+
+// Positions being searched by threads
+#define BUSY_MIN_DEPTH  4   // minimum depth to mark positions
+
+int     busy_enter(U64 key, int depth);
+void    busy_leave(U64 key, int depth);
+
+// Thread pool: workers created once, they wait for a job and run it.
+typedef void *(*POOL_FUNCTION)(void *data);
+
+void    pool_init(int workers);
+void    pool_quit(void);
+int     pool_workers(void);
+void    pool_start(int worker, POOL_FUNCTION function, void *data);
+void    pool_wait(int worker);
+void    pool_run(int count, POOL_FUNCTION function, void *data, size_t data_size);
+
 U64     get_additional_threads_nodes(void);
 U64     get_additional_threads_tbhits(void);
+void    get_threads_tt_stats(GAME *game, TT_STATS *total);
 void    *ponder_search(void *game);
 void    update_pv(PV_LINE *pv_line, int ply, MOVE move);
 int     piece_value(int piece);
@@ -552,6 +711,9 @@ void    check_time(GAME *game);
 int     search(GAME *game, UINT incheck, int alpha, int beta, int depth, MOVE exclude_move);
 int     quiesce(GAME *game, UINT incheck, int alpha, int beta, int depth);
 void    post_info(GAME *game, int score, int depth);
+void    post_line(GAME *game, int score, int depth, int index, MOVE *line, int size);
+int     is_root_excluded(GAME *game, MOVE move);
+void    post_tt_stats(GAME *game);
 int     is_check(BOARD *board, MOVE move);
 S16     score_to_tt(int score, int ply);
 int     score_from_tt(int score, int ply);
@@ -564,14 +726,28 @@ int     piece_value_see(int piece);
 void    tt_age(void);
 void    tt_init(void);
 void    tt_clear(void);
-void    tt_save(U64 key, TT_RECORD *record);
-void    tt_read(U64 key, TT_RECORD *record);
+int     tt_resize(void);
+void    tt_memory_info(char *string);
+void    tt_prefetch(U64 key);
+char    *tt_save_file(char *file_name);
+char    *tt_load_file(char *file_name);
+int     tt_save(U64 key, TT_RECORD *record, int eval);
+void    tt_save_eval(U64 key, int eval);
+int     tt_read(U64 key, TT_RECORD *record, int *eval);
+int     tt_hashfull(void);
 
 // Analyze Mode
 void    analyze_mode(GAME *game);
 
 // Evaluation
 int     evaluate(GAME *game);
+void    eval_cache_init(void);
+void    eval_cache_reset(void);
+void    nnue_compute_accumulator(BOARD *board);
+void    nnue_eager_update(BOARD *board);
+void    nnue_replicas_init(void);
+NNUE_PARAM *nnue_thread_param(void);
+EVAL_CACHE *eval_cache_thread(int thread_number);
 
 // Board
 void    new_game(GAME *game, char *fen);
@@ -625,6 +801,7 @@ U16     get_ply(BOARD *board);
 int     get_played_moves(BOARD *board, char *line, size_t max_chars);
 int     get_history_moves(BOARD *board, MOVE move[], int max_moves);
 U16     get_history_ply(BOARD *board);
+void    set_nnue_root(BOARD *board);
 void    init_seldepth(BOARD *board);
 int     get_played_moves_count(BOARD *board, int color);
 void    move_piece(BOARD *board, int color, int type, int frsq, int tosq);
@@ -637,6 +814,7 @@ void    remove_piece_undo(BOARD *board, int color, int type, int index);
 
 // Utils
 UINT    util_get_time(void);
+U64     util_get_time_us(void);
 void    util_sleep(int milliseconds);
 void    util_get_move_string(MOVE move, char *string);
 void    util_get_move_desc(MOVE move, char *string, int inc_file);
@@ -649,6 +827,27 @@ char    promo_letter(int piece);
 void    util_draw_board(BOARD *board);
 void    save_board_pgn(GAME *game, char *file_name, int book_moves);
 
+// Large memory blocks (huge pages) and NUMA placement
+#define MEM_DEFAULT     0
+#define MEM_HUGE_TLB    1
+#define MEM_LARGE_PAGES 2
+
+typedef struct s_large_memory {
+    void    *address;
+    size_t  size;       // allocated size, can be rounded up to the page size
+    size_t  page_size;  // page size in use
+    int     type;       // how memory was allocated (MEM_...)
+}   LARGE_MEMORY;
+
+int     util_large_alloc(LARGE_MEMORY *memory, size_t size);
+void    util_large_free(LARGE_MEMORY *memory);
+int     util_numa_nodes(void);
+int     util_numa_bind_thread(int node);
+int     util_numa_current_node(void);
+int     util_cpu_list(int node, int *cpus, int max_cpus);
+int     util_bind_thread(int *cpus, int count);
+int     util_numa_interleave(void *address, size_t size);
+
 // PGN utils
 #define PGN_STRING_SIZE 32767
 #define PGN_TAG_SIZE    128
@@ -30,6 +30,7 @@ void        settings_init(void);
 char        line[MAX_READ];
 char        command[MAX_READ] = { '\0' };
 char        syzygy_path[1024] = "";
+char        hash_file[1024] = "";
 
 //-------------------------------------------------------------------------------------------------
 //  Main loop
@@ -48,6 +49,15 @@ int main(int argc, char *argv[])
     // Options
     gThreads = 1;
     gHashSize = 64;
+    gNumaHash = FALSE;
+    gNumaNnue = FALSE;
+    gNnueEager = FALSE;
+    gTTStats = FALSE;
+    gEvalCacheSize = 1;
+    gEvalCacheShared = FALSE;
+    gAffinity = AFFINITY_NONE;
+    gMultiPV = 1;
+    gDebug = FALSE;
 
     printf("%s chess engine by %s - %s (type 'help' for information)\n", ENGINE, AUTHOR, VERSION);
 
@@ -59,6 +69,21 @@ int main(int argc, char *argv[])
         if (!strcmp("-threads", argv[i])) {
             if (++i < argc) gThreads = valid_threads(atoi(argv[i]));
         }
+        if (!strcmp("-affinity", argv[i])) {
+            if (++i < argc && !threads_affinity(argv[i])) printf("invalid affinity: %s\n", argv[i]);
+        }
+        if (!strcmp("-numa_hash", argv[i])) {
+            gNumaHash = TRUE;
+        }
+        if (!strcmp("-numa_nnue", argv[i])) {
+            gNumaNnue = TRUE;
+        }
+        if (!strcmp("-nnue_eager", argv[i])) {
+            gNnueEager = TRUE;
+        }
+        if (!strcmp("-hash_file", argv[i])) {
+            if (++i < argc) strcpy(hash_file, argv[i]);
+        }
         if (!strcmp("-ponder", argv[i])) {
             ponder_on = TRUE;
         }
@@ -92,7 +117,7 @@ int main(int argc, char *argv[])
         }
     }
 
-    printf("   hash table: %d MB, threads: %d, architecture: %s\n", gHashSize, gThreads, NNUE_ARCH);
+    printf("   hash table: %d MB, threads: %d, architecture: %s\n", gHashSize, gThreads, nnue_arch());
 
     // Initializations
     srand((UINT)19810505);
@@ -100,8 +125,13 @@ int main(int argc, char *argv[])
     bb_data_init();
     magic_init();
     book_init();
-    tt_init();
     threads_init();
+    tt_init();
+    eval_cache_init();
+    nnue_replicas_init();
+    char memory_info[200];
+    tt_memory_info(memory_info);
+    printf("   %s\n", memory_info);
 #ifdef EGTB_SYZYGY
     if (strlen(syzygy_path) != 0) {
         if (tb_init(syzygy_path)) {
@@ -114,6 +144,14 @@ int main(int argc, char *argv[])
     
     new_game(&main_game, FEN_NEW_GAME);
 
+    if (strlen(hash_file) != 0) {
+        char *error = tt_load_file(hash_file);
+        if (error == NULL)
+            printf("hash file '%s' loaded, hash table: %d MB\n", hash_file, gHashSize);
+        else
+            printf("hash file error: %s: '%s' !\n", error, hash_file);
+    }
+
 #ifndef NDEBUG
     printf("\nDEBUG MODE ON (running with asserts)\n");
 #endif
@@ -168,8 +206,9 @@ int main(int argc, char *argv[])
             continue;
         }
         if (ponder_on && ponder_thread != 0) {
-            ponder_game.search.abort = TRUE;
+            search_signal(SIGNAL_STOP);
             THREAD_WAIT(ponder_thread);
+            search_signal_clear(SIGNAL_STOP);
             ponder_thread = 0;
         }
         if (!strcmp(command, "xboard"))  {
@@ -234,6 +273,13 @@ int main(int argc, char *argv[])
             printf("feature analyze=1\n");
             printf("feature option=\"Hash -spin 64 %d %d\"\n", MIN_HASH_SIZE, MAX_HASH_SIZE);
             printf("feature option=\"Threads -spin 1 %d %d\"\n", MIN_THREADS, MAX_THREADS);
+            printf("feature option=\"Affinity -string none\"\n");
+            printf("feature option=\"NumaHash -check 0\"\n");
+            printf("feature option=\"NumaNnue -check 0\"\n");
+            printf("feature option=\"NnueEager -check 0\"\n");
+            printf("feature option=\"TTStats -check 0\"\n");
+            printf("feature option=\"EvalCache -spin 1 %d %d\"\n", MIN_EVAL_CACHE_SIZE, MAX_EVAL_CACHE_SIZE);
+            printf("feature option=\"EvalCacheShared -check 0\"\n");
 #ifdef EGTB_SYZYGY
             printf("feature option=\"SyzygyPath -path \"\"\"\n");
 #endif
@@ -241,15 +287,51 @@ int main(int argc, char *argv[])
             continue;
         }
         if (!strcmp(command, "option")) {
-            if (strstr(line, "Hash")) {
+            if (strstr(line, "TTStats")) {
+                sscanf(line, "option TTStats=%d", &gTTStats);
+            }
+            else if (strstr(line, "EvalCacheShared")) {
+                sscanf(line, "option EvalCacheShared=%d", &gEvalCacheShared);
+                eval_cache_init();
+            }
+            else if (strstr(line, "EvalCache")) {
+                sscanf(line, "option EvalCache=%d", &gEvalCacheSize);
+                gEvalCacheSize = MAX(MIN_EVAL_CACHE_SIZE, MIN(gEvalCacheSize, MAX_EVAL_CACHE_SIZE));
+                eval_cache_init();
+            }
+            else if (strstr(line, "NnueEager")) {
+                sscanf(line, "option NnueEager=%d", &gNnueEager);
+            }
+            else if (strstr(line, "NumaNnue")) {
+                sscanf(line, "option NumaNnue=%d", &gNumaNnue);
+                nnue_replicas_init();
+                main_game.nnue_param = nnue_thread_param();
+            }
+            else if (strstr(line, "NumaHash")) {
+                sscanf(line, "option NumaHash=%d", &gNumaHash);
+                tt_init();
+            }
+            else if (strstr(line, "Hash")) {
                 sscanf(line, "option Hash=%d", &gHashSize);
                 gHashSize = valid_hash_size(gHashSize);
-                tt_init();
+                if (!tt_resize()) printf("no memory for hash table, hash table: %d MB\n", gHashSize);
+            }
+            if (strstr(line, "Affinity")) {
+                char policy[256] = "";
+                sscanf(line, "option Affinity=%255s", policy);
+                if (threads_affinity(policy)) {
+                    threads_init();
+                    eval_cache_init();
+                }
+                else {
+                    printf("invalid affinity: %s\n", policy);
+                }
             }
             if (strstr(line, "Threads")) {
                 sscanf(line, "option Threads=%d", &gThreads);
                 gThreads = valid_threads(gThreads);
                 threads_init();
+                eval_cache_init();
             }
 #ifdef EGTB_SYZYGY
             if (strstr(line, "SyzygyPath")) {
@@ -369,6 +451,12 @@ int main(int argc, char *argv[])
                 printf("no fen position entered.\n");
             continue;
         }
+        if (!strcmp(command, "ttstats")) {
+            //  Toggle transposition table statistics after each search.
+            gTTStats = !gTTStats;
+            printf("tt statistics are %s\n", (gTTStats ? "ON" : "OFF"));
+            continue;
+        }
         if (!strcmp(command, "book")) {
             //  Toggle book use flag.
             game_settings.use_book = !game_settings.use_book;
@@ -407,6 +495,19 @@ int main(int argc, char *argv[])
             trans_table_test("2k5/8/1pP1K3/1P6/8/8/8/8 w - -", "Best move would be c7, score 9+.\n");
             continue;
         }
+        if (!strcmp(command, "savehash") || !strcmp(command, "loadhash")) {
+            //  Save/load hash table content to keep it between sessions.
+            if (sscanf(line, "%*s %1023s", hash_file) != 1) {
+                printf("syntax: %s <hash file name>\n", command);
+                continue;
+            }
+            char *error = !strcmp(command, "savehash") ? tt_save_file(hash_file) : tt_load_file(hash_file);
+            if (error == NULL)
+                printf("hash file '%s' %s, hash table: %d MB\n", hash_file, !strcmp(command, "savehash") ? "saved" : "loaded", gHashSize);
+            else
+                printf("hash file error: %s: '%s' !\n", error, hash_file);
+            continue;
+        }
         if (!strcmp(command, "epd")) {
             //  epd test to locate best move. 
             //  fen should contains "bm" for best move.
@@ -454,14 +555,23 @@ int main(int argc, char *argv[])
             printf("epd <filename>: locate best move for epd positions in the file\n");
             printf("                file should contains epd's and best moves in the format:\n");
             printf("                8/2Q5/2p5/p7/Pk6/2q5/4K3/8 w - - 0 53 bm Qe7;\n");
+            printf("       ttstats: toggle transposition table statistics after each search.\n");
+            printf("savehash <file>: save hash table content to a file.\n");
+            printf("loadhash <file>: load hash table content saved by savehash, table is resized to the file size.\n");
             printf("     perft <n>: show perft move count from current position.\n");
             printf("                other perft commands: perftx, perfty, perftz\n");
             printf("\n");
             printf("\n");
             printf("Command line options:\n\n");
-            printf(" tucano -hash <MB> -threads <#> -syzygy_path <path>\n");
+            printf(" tucano -hash <MB> -threads <#> -affinity <policy> -numa_hash -numa_nnue -nnue_eager -hash_file <file> -syzygy_path <path>\n");
             printf("   -hash indicates the size of hash table, default = 64 MB, minimum: %d MB, maximum: %d MB.\n", MIN_HASH_SIZE, MAX_HASH_SIZE);
             printf("   -threads indicates how many threads to use during search, minimum: %d, maximum: %d.\n", MIN_THREADS, MAX_THREADS);
+            printf("   -affinity binds search threads to cpus: none (default), compact (fill a numa node first),\n");
+            printf("      scatter (alternate numa nodes), numa (any cpu of the thread numa node) or a cpu list like 0,2,8-15.\n");
+            printf("   -numa_hash spreads the hash table over all numa nodes.\n");
+            printf("   -numa_nnue keeps a copy of the network weights on each numa node.\n");
+            printf("   -nnue_eager updates the network accumulators when moves are made, instead of at evaluation.\n");
+            printf("   -hash_file loads hash table content saved by 'savehash' command.\n");
             printf("   -syzygy_path indicates the path of Syzygy end game tablebases.\n");
             printf("\n");
             continue;
@@ -478,6 +588,8 @@ int main(int argc, char *argv[])
         }
     }
 
+    pool_quit();
+
     return 0;
 }
 
@@ -494,6 +606,8 @@ void settings_init(void)
     game_settings.post_flag = POST_DEFAULT;
     game_settings.use_book = FALSE;
     game_settings.max_nodes = 0;
+    game_settings.search_moves_count = 0;
+    game_settings.mate = 0;
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -539,6 +653,8 @@ double bench(int depth, int print)
     settings.increment_time = 0;
     settings.use_book = FALSE;
     settings.max_nodes = 0;
+    settings.search_moves_count = 0;
+    settings.mate = 0;
 
     if (print) printf("Benchmark (depth=%d)\n", depth);
 
@@ -148,11 +148,15 @@ MOVE next_move(MOVE_LIST *ml)
         ml->phase = GEN_CAP;
         if (ml->ttm != MOVE_NONE)  {
             if (is_valid(ml->board, ml->ttm)) {
-                // Have to make the move in order to test for check legality.
-                // Some moves coming from tt are valid for the position but leave the king in check.
-                make_move(ml->board, ml->ttm);
-                if (is_illegal(ml->board, ml->ttm)) ml->ttm = MOVE_NONE;
-                undo_move(ml->board);
+                // is_valid confirms the move can be played here and the search tests it with
+                // is_pseudo_legal, which covers pins and king moves. That holds even for a move from a
+                // key collision, which is rare as entries verify all key bits. Check evasions are not
+                // covered by is_pseudo_legal, so in that case have to make the move to test legality.
+                if (ml->incheck) {
+                    make_move(ml->board, ml->ttm);
+                    if (is_illegal(ml->board, ml->ttm)) ml->ttm = MOVE_NONE;
+                    undo_move(ml->board);
+                }
                 if (ml->ttm != MOVE_NONE) return ml->ttm;
             }
             ml->ttm = MOVE_NONE;
@@ -23,7 +23,17 @@
 
 #define VECTOR
 
-#ifdef USE_AVX2
+#if defined(USE_AVX512)
+#define SIMD_WIDTH 512
+typedef __m512i vec16_t;
+typedef __m512i vec8_t;
+typedef uint64_t mask_t;
+#define vec_add_16(a,b) _mm512_add_epi16(a,b)
+#define vec_sub_16(a,b) _mm512_sub_epi16(a,b)
+#define vec_packs(a,b) _mm512_packs_epi16(a,b)
+#define vec_mask_pos(a) _mm512_cmpgt_epi8_mask(a,_mm512_setzero_si512())
+#define NUM_REGS 8 // one tile for the 256 accumulator values
+#elif defined(USE_AVX2)
 #define SIMD_WIDTH 256
 typedef __m256i vec16_t;
 typedef __m256i vec8_t;
@@ -77,17 +87,142 @@ typedef uint8_t mask_t; // dummy
 #define TILE_HEIGHT (NUM_REGS * SIMD_WIDTH / 16)
 #endif
 
-uint32_t PIECE_TO_INDEX[2][14] = {
+#if defined(__GNUC__)
+#define bsf(b) __builtin_ctzll(b)
+#define bsr(b) (63 - __builtin_clzll(b))
+#elif defined(_WIN32)
+#include <intrin.h>
+static int bsf(uint64_t b) {
+    unsigned long x;
+    _BitScanForward64(&x, b);
+    return (int)x;
+}
+static int bsr(uint64_t b) {
+    unsigned long x;
+    _BitScanReverse64(&x, b);
+    return (int)x;
+}
+#endif
+
+static const uint32_t PIECE_TO_INDEX[2][14] = {
   { 0, 0, PS_W_QUEEN, PS_W_ROOK, PS_W_BISHOP, PS_W_KNIGHT, PS_W_PAWN,
        0, PS_B_QUEEN, PS_B_ROOK, PS_B_BISHOP, PS_B_KNIGHT, PS_B_PAWN, 0},
   { 0, 0, PS_B_QUEEN, PS_B_ROOK, PS_B_BISHOP, PS_B_KNIGHT, PS_B_PAWN,
        0, PS_W_QUEEN, PS_W_ROOK, PS_W_BISHOP, PS_W_KNIGHT, PS_W_PAWN, 0}
 };
 
+//-------------------------------------------------------------------------------------------------
+//  Weights layout for the hidden and output layers: columns are permuted to match the order of
+//  outputs of the simd instructions used.
+//-------------------------------------------------------------------------------------------------
+#ifdef USE_AVX2
+static void nnue_permute_biases(int32_t *biases)
+{
+    __m128i *b = (__m128i *)biases;
+    __m128i tmp[8];
+#ifdef USE_AVX512
+    tmp[0] = b[0];
+    tmp[1] = b[2];
+    tmp[2] = b[4];
+    tmp[3] = b[6];
+    tmp[4] = b[1];
+    tmp[5] = b[3];
+    tmp[6] = b[5];
+    tmp[7] = b[7];
+#elif USE_AVX2
+    tmp[0] = b[0];
+    tmp[1] = b[4];
+    tmp[2] = b[1];
+    tmp[3] = b[5];
+    tmp[4] = b[2];
+    tmp[5] = b[6];
+    tmp[6] = b[3];
+    tmp[7] = b[7];
+#else
+#error
+#endif
+    memcpy(b, tmp, 8 * sizeof(__m128i));
+}
+#endif
+
+static unsigned nnue_weight_index(unsigned r, unsigned c, unsigned dims)
+{
+    (void)dims;
+#if defined(USE_AVX512)
+    if (dims > 32) {
+        unsigned b = c & 0x38;
+        b = (b << 1) | (b >> 2);
+        c = (c & ~0x38) | (b & 0x38);
+    }
+    else if (dims == 32) {
+        unsigned b = c & 0x18;
+        b = (b << 1) | (b >> 1);
+        c = (c & ~0x18) | (b & 0x18);
+    }
+#elif defined(USE_AVX2)
+    if (dims > 32) {
+        unsigned b = c & 0x18;
+        b = (b << 1) | (b >> 1);
+        c = (c & ~0x18) | (b & 0x18);
+    }
+#endif
+#if defined(USE_AVX512)
+    return c * 64 + r + (r & ~7);
+#else
+    return c * 32 + r;
+#endif
+}
+
+static const char *nnue_read_hidden_weights(weight_t *w, unsigned dims, const char *d)
+{
+    for (unsigned r = 0; r < 32; r++) {
+        for (unsigned c = 0; c < dims; c++) {
+            w[nnue_weight_index(r, c, dims)] = *d++;
+        }
+    }
+    return d;
+}
+
+static void nnue_read_output_weights(weight_t *w, const char *d)
+{
+    for (unsigned i = 0; i < 32; i++) {
+        unsigned c = i;
+#if defined(USE_AVX512)
+        unsigned b = c & 0x18;
+        b = (b << 1) | (b >> 1);
+        c = (c & ~0x18) | (b & 0x18);
+#endif
+        w[c] = *d++;
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+//  Read network layers from eval file data, in the layout used by this kernel.
+//-------------------------------------------------------------------------------------------------
+void NNUE_KERNEL(nnue_init_network)(NNUE_PARAM *p_nnue_param, const char *d)
+{
+    for (unsigned i = 0; i < 32; i++, d += 4) {
+        p_nnue_param->hidden1_biases[i] = nnue_read_u32(d);
+    }
+    d = nnue_read_hidden_weights((weight_t *)p_nnue_param->hidden1_weights, 512, d);
+    for (unsigned i = 0; i < 32; i++, d += 4) {
+        p_nnue_param->hidden2_biases[i] = nnue_read_u32(d);
+    }
+    d = nnue_read_hidden_weights((weight_t *)p_nnue_param->hidden2_weights, 32, d);
+    for (unsigned i = 0; i < 1; i++, d += 4) {
+        p_nnue_param->output_biases[i] = nnue_read_u32(d);
+    }
+    nnue_read_output_weights((weight_t *)p_nnue_param->output_weights, d);
+#ifdef USE_AVX2
+    nnue_permute_biases(p_nnue_param->hidden1_biases);
+    nnue_permute_biases(p_nnue_param->hidden2_biases);
+#endif
+}
+
 //-------------------------------------------------------------------------------------------------
 //  Translate square position regarding color
 //-------------------------------------------------------------------------------------------------
-int nnue_orient(int c, int s)
+static int nnue_orient(int c, int s)
 {
     return s ^ (c == NNUE_WHITE ? 0x00 : 0x3f);
 }
@@ -95,7 +230,7 @@ int nnue_orient(int c, int s)
 //-------------------------------------------------------------------------------------------------
 //  Index for the piece in relation to color/king.
 //-------------------------------------------------------------------------------------------------
-unsigned nnue_make_index(int c, int s, int pc, int ksq)
+static unsigned nnue_make_index(int c, int s, int pc, int ksq)
 {
     return nnue_orient(c, s) + PIECE_TO_INDEX[c][pc] + PS_END * ksq;
 }
@@ -103,7 +238,7 @@ unsigned nnue_make_index(int c, int s, int pc, int ksq)
 //-------------------------------------------------------------------------------------------------
 //  Calculate and list indexes for all pieces in the position
 //-------------------------------------------------------------------------------------------------
-void nnue_half_kp_append_active_indices(const NNUE_POSITION *pos, const int c, NNUE_INDEXES *active)
+static void nnue_half_kp_append_active_indices(const NNUE_POSITION *pos, const int c, NNUE_INDEXES *active)
 {
     int ksq = pos->squares[c];
     ksq = nnue_orient(c, ksq);
@@ -117,7 +252,7 @@ void nnue_half_kp_append_active_indices(const NNUE_POSITION *pos, const int c, N
 //-------------------------------------------------------------------------------------------------
 //  Calculate indexes for pieces that have changed in the position
 //-------------------------------------------------------------------------------------------------
-void nnue_half_kp_append_changed_indices(const NNUE_POSITION *pos, const int c,
+static void nnue_half_kp_append_changed_indices(const NNUE_POSITION *pos, const int c,
     const NNUE_CHANGE *changes,
     NNUE_INDEXES *removed, NNUE_INDEXES *added)
 {
@@ -138,25 +273,15 @@ void nnue_half_kp_append_changed_indices(const NNUE_POSITION *pos, const int c,
 }
 
 //-------------------------------------------------------------------------------------------------
-//  Used to refresh accumulators
-//-------------------------------------------------------------------------------------------------
-void nnue_append_active_indices(const NNUE_POSITION *pos, NNUE_INDEXES active[2])
-{
-    for (unsigned c = 0; c < 2; c++) {
-        nnue_half_kp_append_active_indices(pos, c, &active[c]);
-    }
-}
-
-//-------------------------------------------------------------------------------------------------
-//  Indicate a king move in the changed pieces, in this case will reset accumulators
+//  Indicate a move of the king of perspective c, in this case its accumulator is refreshed.
 //-------------------------------------------------------------------------------------------------
-int nnue_has_king_move(const NNUE_CHANGE *changes)
+static int nnue_king_moved(const NNUE_CHANGE *changes, int c)
 {
-    if (NNUE_IS_KING(changes->piece[0])) {
-        return TRUE;
-    }
-    if (changes->count > 0 && NNUE_IS_KING(changes->piece[1])) {
-        return TRUE;
+    int king = c == NNUE_WHITE ? wking : bking;
+    for (int i = 0; i < changes->count; i++) {
+        if (changes->piece[i] == king) {
+            return TRUE;
+        }
     }
     return FALSE;
 }
@@ -164,68 +289,130 @@ int nnue_has_king_move(const NNUE_CHANGE *changes)
 //-------------------------------------------------------------------------------------------------
 //  Use list of changed pieces (aka dirty pieces) to generate list of accumulators indexes
 //-------------------------------------------------------------------------------------------------
-void nnue_append_changed_indices(const NNUE_POSITION *pos, NNUE_INDEXES removed[2], NNUE_INDEXES added[2], int reset[2])
+static void nnue_append_changed_indices(const NNUE_POSITION *pos, NNUE_INDEXES removed[2], NNUE_INDEXES added[2], int reset[2])
 {
     NNUE_CHANGE *changes = &pos->current_nnue_data->changes;
     for (unsigned c = 0; c < 2; c++) {
-        reset[c] = nnue_has_king_move(changes);
-        if (reset[c]) {
-            nnue_half_kp_append_active_indices(pos, c, &added[c]);
-        }
-        else {
+        reset[c] = nnue_king_moved(changes, c);
+        if (!reset[c]) {
             nnue_half_kp_append_changed_indices(pos, c, changes, &removed[c], &added[c]);
         }
     }
 }
 
 //-------------------------------------------------------------------------------------------------
-//  Calculate cumulative value without using difference calculation
+//  Accumulator of one perspective: output = input - removed features + added features.
+//  Output and input can be the same.
 //-------------------------------------------------------------------------------------------------
-void nnue_refresh_accumulator(NNUE_POSITION *pos)
+static void nnue_accumulate(const NNUE_PARAM *param, int16_t *output, const int16_t *input,
+    const NNUE_INDEXES *removed, const NNUE_INDEXES *added)
 {
-    NNUE_ACCUM *accumulator = &(pos->current_nnue_data->accumulator);
-    NNUE_INDEXES activeIndices[2];
-    activeIndices[0].size = activeIndices[1].size = 0;
-    nnue_append_active_indices(pos, activeIndices);
-    for (unsigned c = 0; c < 2; c++) {
 #ifdef VECTOR
-        for (unsigned i = 0; i < KHALF_DIMENSIONS / TILE_HEIGHT; i++) {
-            vec16_t *ft_biases_tile = (vec16_t *)&nnue_param.ft_biases[i * TILE_HEIGHT];
-            vec16_t *accTile = (vec16_t *)&accumulator->accumulation[c][i * TILE_HEIGHT];
-            vec16_t acc[NUM_REGS];
+    for (unsigned i = 0; i < KHALF_DIMENSIONS / TILE_HEIGHT; i++) {
+        const vec16_t *inTile = (const vec16_t *)&input[i * TILE_HEIGHT];
+        vec16_t *outTile = (vec16_t *)&output[i * TILE_HEIGHT];
+        vec16_t acc[NUM_REGS];
+        for (unsigned j = 0; j < NUM_REGS; j++) {
+            acc[j] = inTile[j];
+        }
+        // Difference calculation for the deactivated features
+        for (unsigned k = 0; k < removed->size; k++) {
+            unsigned index = removed->values[k];
+            const unsigned offset = KHALF_DIMENSIONS * index + i * TILE_HEIGHT;
+            const vec16_t *column = (const vec16_t *)&param->ft_weights[offset];
             for (unsigned j = 0; j < NUM_REGS; j++) {
-                acc[j] = ft_biases_tile[j];
-            }
-            for (size_t k = 0; k < activeIndices[c].size; k++) {
-                unsigned index = activeIndices[c].values[k];
-                unsigned offset = KHALF_DIMENSIONS * index + i * TILE_HEIGHT;
-                vec16_t *column = (vec16_t *)&nnue_param.ft_weights[offset];
-                for (unsigned j = 0; j < NUM_REGS; j++) {
-                    acc[j] = vec_add_16(acc[j], column[j]);
-                }
+                acc[j] = vec_sub_16(acc[j], column[j]);
             }
+        }
+        // Difference calculation for the activated features
+        for (unsigned k = 0; k < added->size; k++) {
+            unsigned index = added->values[k];
+            const unsigned offset = KHALF_DIMENSIONS * index + i * TILE_HEIGHT;
+            const vec16_t *column = (const vec16_t *)&param->ft_weights[offset];
             for (unsigned j = 0; j < NUM_REGS; j++) {
-                accTile[j] = acc[j];
+                acc[j] = vec_add_16(acc[j], column[j]);
             }
         }
+        for (unsigned j = 0; j < NUM_REGS; j++) {
+            outTile[j] = acc[j];
+        }
+    }
 #else
-        memcpy(accumulator->accumulation[c], nnue_param.ft_biases, KHALF_DIMENSIONS * sizeof(int16_t));
-        for (size_t k = 0; k < activeIndices[c].size; k++) {
-            unsigned index = activeIndices[c].values[k];
-            unsigned offset = KHALF_DIMENSIONS * index;
-            for (unsigned j = 0; j < KHALF_DIMENSIONS; j++) {
-                accumulator->accumulation[c][j] += nnue_param.ft_weights[offset + j];
-            }
+    if (output != input) {
+        memcpy(output, input, KHALF_DIMENSIONS * sizeof(int16_t));
+    }
+    // Difference calculation for the deactivated features
+    for (unsigned k = 0; k < removed->size; k++) {
+        const unsigned offset = KHALF_DIMENSIONS * removed->values[k];
+        for (unsigned j = 0; j < KHALF_DIMENSIONS; j++) {
+            output[j] -= param->ft_weights[offset + j];
         }
+    }
+    // Difference calculation for the activated features
+    for (unsigned k = 0; k < added->size; k++) {
+        const unsigned offset = KHALF_DIMENSIONS * added->values[k];
+        for (unsigned j = 0; j < KHALF_DIMENSIONS; j++) {
+            output[j] += param->ft_weights[offset + j];
+        }
+    }
 #endif
+}
+
+//-------------------------------------------------------------------------------------------------
+//  Refresh the accumulator of one perspective. With a refresh cache, start from the cached
+//  accumulator of the king square and apply only the pieces that differ from the cached position.
+//  Otherwise sum all pieces.
+//-------------------------------------------------------------------------------------------------
+static void nnue_refresh_perspective(const NNUE_POSITION *pos, int c)
+{
+    NNUE_PARAM *param = pos->param;
+    int16_t *accumulation = pos->current_nnue_data->accumulator.accumulation[c];
+    NNUE_INDEXES removed, added;
+    removed.size = added.size = 0;
+
+    if (pos->finny == NULL) {
+        nnue_half_kp_append_active_indices(pos, c, &added);
+        nnue_accumulate(param, accumulation, param->ft_biases, &removed, &added);
+        return;
     }
-    accumulator->computed = TRUE;
+
+    NNUE_FINNY_ENTRY *entry = &pos->finny->entry[c][pos->squares[c]];
+    uint64_t pieces_bb[13] = { 0 };
+    for (int i = 2; pos->pieces[i]; i++) {
+        pieces_bb[pos->pieces[i]] |= (uint64_t)1 << pos->squares[i];
+    }
+    int ksq = nnue_orient(c, pos->squares[c]);
+    for (int pc = wqueen; pc <= bpawn; pc++) {
+        if (pc == bking) continue;
+        uint64_t removed_bb = entry->pieces_bb[pc] & ~pieces_bb[pc];
+        uint64_t added_bb = pieces_bb[pc] & ~entry->pieces_bb[pc];
+        for (; removed_bb; removed_bb &= removed_bb - 1) {
+            removed.values[removed.size++] = nnue_make_index(c, bsf(removed_bb), pc, ksq);
+        }
+        for (; added_bb; added_bb &= added_bb - 1) {
+            added.values[added.size++] = nnue_make_index(c, bsf(added_bb), pc, ksq);
+        }
+        entry->pieces_bb[pc] = pieces_bb[pc];
+    }
+    nnue_accumulate(param, entry->accumulation, entry->accumulation, &removed, &added);
+    memcpy(accumulation, entry->accumulation, KHALF_DIMENSIONS * sizeof(int16_t));
+}
+
+//-------------------------------------------------------------------------------------------------
+//  Calculate cumulative value without using difference calculation
+//-------------------------------------------------------------------------------------------------
+void NNUE_KERNEL(nnue_refresh_accumulator)(NNUE_POSITION *pos)
+{
+    for (int c = 0; c < 2; c++) {
+        nnue_refresh_perspective(pos, c);
+    }
+    pos->current_nnue_data->accumulator.computed = TRUE;
 }
 
 //-------------------------------------------------------------------------------------------------
 //  Update current position accumulator using previous position info
 //-------------------------------------------------------------------------------------------------
-void nnue_update_accumulator(NNUE_POSITION *pos)
+void NNUE_KERNEL(nnue_update_accumulator)(NNUE_POSITION *pos)
 {
     NNUE_ACCUM *accumulator = &(pos->current_nnue_data->accumulator);
     NNUE_ACCUM *prevAcc = &(pos->previous_nnue_data->accumulator);
@@ -234,79 +421,22 @@ void nnue_update_accumulator(NNUE_POSITION *pos)
     added_indices[0].size = added_indices[1].size = 0;
     int reset[2];
     nnue_append_changed_indices(pos, removed_indices, added_indices, reset);
-#ifdef VECTOR
-    for (unsigned i = 0; i < KHALF_DIMENSIONS / TILE_HEIGHT; i++) {
-        for (unsigned c = 0; c < 2; c++) {
-            vec16_t *accTile = (vec16_t *)&accumulator->accumulation[c][i * TILE_HEIGHT];
-            vec16_t acc[NUM_REGS];
-            if (reset[c]) {
-                vec16_t *ft_b_tile = (vec16_t *)&nnue_param.ft_biases[i * TILE_HEIGHT];
-                for (unsigned j = 0; j < NUM_REGS; j++) {
-                    acc[j] = ft_b_tile[j];
-                }
-            }
-            else {
-                vec16_t *prevAccTile = (vec16_t *)&prevAcc->accumulation[c][i * TILE_HEIGHT];
-                for (unsigned j = 0; j < NUM_REGS; j++) {
-                    acc[j] = prevAccTile[j];
-                }
-                // Difference calculation for the deactivated features
-                for (unsigned k = 0; k < removed_indices[c].size; k++) {
-                    unsigned index = removed_indices[c].values[k];
-                    const unsigned offset = KHALF_DIMENSIONS * index + i * TILE_HEIGHT;
-                    vec16_t *column = (vec16_t *)&nnue_param.ft_weights[offset];
-                    for (unsigned j = 0; j < NUM_REGS; j++) {
-                        acc[j] = vec_sub_16(acc[j], column[j]);
-                    }
-                }
-            }
-            // Difference calculation for the activated features
-            for (unsigned k = 0; k < added_indices[c].size; k++) {
-                unsigned index = added_indices[c].values[k];
-                const unsigned offset = KHALF_DIMENSIONS * index + i * TILE_HEIGHT;
-                vec16_t *column = (vec16_t *)&nnue_param.ft_weights[offset];
-                for (unsigned j = 0; j < NUM_REGS; j++) {
-                    acc[j] = vec_add_16(acc[j], column[j]);
-                }
-            }
-            for (unsigned j = 0; j < NUM_REGS; j++) {
-                accTile[j] = acc[j];
-            }
-        }
-    }
-#else
-    for (unsigned c = 0; c < 2; c++) {
+    for (int c = 0; c < 2; c++) {
         if (reset[c]) {
-            memcpy(accumulator->accumulation[c], nnue_param.ft_biases, KHALF_DIMENSIONS * sizeof(int16_t));
+            nnue_refresh_perspective(pos, c);
         }
         else {
-            memcpy(accumulator->accumulation[c], prevAcc->accumulation[c], KHALF_DIMENSIONS * sizeof(int16_t));
-            // Difference calculation for the deactivated features
-            for (unsigned k = 0; k < removed_indices[c].size; k++) {
-                unsigned index = removed_indices[c].values[k];
-                const unsigned offset = KHALF_DIMENSIONS * index;
-                for (unsigned j = 0; j < KHALF_DIMENSIONS; j++) {
-                    accumulator->accumulation[c][j] -= nnue_param.ft_weights[offset + j];
-                }
-            }
-        }
-        // Difference calculation for the activated features
-        for (unsigned k = 0; k < added_indices[c].size; k++) {
-            unsigned index = added_indices[c].values[k];
-            const unsigned offset = KHALF_DIMENSIONS * index;
-            for (unsigned j = 0; j < KHALF_DIMENSIONS; j++) {
-                accumulator->accumulation[c][j] += nnue_param.ft_weights[offset + j];
-            }
+            nnue_accumulate(pos->param, accumulator->accumulation[c], prevAcc->accumulation[c],
+                &removed_indices[c], &added_indices[c]);
         }
     }
-#endif
     accumulator->computed = TRUE;
 }
 
 //-------------------------------------------------------------------------------------------------
 //  Calculate output layer
 //-------------------------------------------------------------------------------------------------
-int32_t nnue_affine_propagate(int8_t *input, int32_t *biases, weight_t *weights)
+static int32_t nnue_affine_propagate(int8_t *input, int32_t *biases, weight_t *weights)
 {
 #if defined(USE_AVX2)
     __m256i *iv = (__m256i *)input;
@@ -372,25 +502,8 @@ int32_t nnue_affine_propagate(int8_t *input, int32_t *biases, weight_t *weights)
 #endif
 }
 
-#if defined(__GNUC__)
-#define bsf(b) __builtin_ctzll(b)
-#define bsr(b) (63 - __builtin_clzll(b))
-#elif defined(_WIN32)
-#include <intrin.h>
-int bsf(uint64_t b) {
-    unsigned long x;
-    _BitScanForward64(&x, b);
-    return (int)x;
-}
-int bsr(uint64_t b) {
-    unsigned long x;
-    _BitScanReverse64(&x, b);
-    return (int)x;
-}
-#endif
-
 #ifdef VECTOR
-int nnue_next_index(unsigned *idx, unsigned *offset, mask2_t *v, mask_t *mask, unsigned inDims)
+static int nnue_next_index(unsigned *idx, unsigned *offset, mask2_t *v, mask_t *mask, unsigned inDims)
 {
     while (*v == 0) {
         *offset += 8 * sizeof(mask2_t);
@@ -402,7 +515,7 @@ int nnue_next_index(unsigned *idx, unsigned *offset, mask2_t *v, mask_t *mask, u
     return TRUE;
 }
 #if defined(USE_MMX) && !defined(USE_SSE)
-int _mm_movemask_pi8(__m64 v)
+static int _mm_movemask_pi8(__m64 v)
 {
     const __m64 powers = _mm_set_pi8(-128, 64, 32, 16, 8, 4, 2, 1);
     __m64 m = _mm_and_si64(v, powers);
@@ -412,7 +525,7 @@ int _mm_movemask_pi8(__m64 v)
     return _mm_cvtsi64_si32(m) & 0xff;
 }
 #elif defined(USE_NEON)
-int neon_movemask(uint8x16_t v)
+static int neon_movemask(uint8x16_t v)
 {
     const uint8_t __attribute__((aligned(16))) powers[16] =
     { 1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128 };
@@ -425,8 +538,77 @@ int neon_movemask(uint8x16_t v)
 #endif
 #endif
 
-#if defined(USE_AVX2)
-void nnue_affine_txfm(int8_t *input, void *output, unsigned inDims,
+#if defined(USE_AVX512)
+//-------------------------------------------------------------------------------------------------
+//  Hidden layer for AVX512. Weights of each input are in the low 8 bytes of each 128 bit lane (see
+//  nnue_weight_index), so the unpacked weights of the inputs give 8 outputs for each lane. VNNI
+//  multiplies and adds 4 inputs in one instruction, keeping the same order of outputs.
+//-------------------------------------------------------------------------------------------------
+static void nnue_affine_txfm(int8_t *input, void *output, unsigned inDims,
+    unsigned outDims, const int32_t *biases, const weight_t *weights,
+    mask_t *inMask, mask_t *outMask, const int pack8_and_calc_mask)
+{
+    assert(outDims == 32);
+
+    (void)outDims;
+    const __m512i kZero = _mm512_setzero_si512();
+    __m512i out_0 = ((__m512i *)biases)[0];
+    __m512i out_1 = ((__m512i *)biases)[1];
+    __m512i *rows = (__m512i *)weights;
+    mask2_t v;
+    unsigned idx;
+
+    memcpy(&v, inMask, sizeof(mask2_t));
+    for (unsigned offset = 0; offset < inDims;) {
+        if (!nnue_next_index(&idx, &offset, &v, inMask, inDims))
+            break;
+#if defined(USE_VNNI)
+        __m512i first = rows[idx], second = kZero, third = kZero, fourth = kZero;
+        uint32_t factor = (uint8_t)input[idx];
+        if (nnue_next_index(&idx, &offset, &v, inMask, inDims)) {
+            second = rows[idx];
+            factor |= (uint32_t)(uint8_t)input[idx] << 8;
+            if (nnue_next_index(&idx, &offset, &v, inMask, inDims)) {
+                third = rows[idx];
+                factor |= (uint32_t)(uint8_t)input[idx] << 16;
+                if (nnue_next_index(&idx, &offset, &v, inMask, inDims)) {
+                    fourth = rows[idx];
+                    factor |= (uint32_t)(uint8_t)input[idx] << 24;
+                }
+            }
+        }
+        __m512i mul = _mm512_set1_epi32((int)factor);
+        __m512i pairs_0 = _mm512_unpacklo_epi8(first, second);
+        __m512i pairs_1 = _mm512_unpacklo_epi8(third, fourth);
+        out_0 = _mm512_dpbusd_epi32(out_0, mul, _mm512_unpacklo_epi16(pairs_0, pairs_1));
+        out_1 = _mm512_dpbusd_epi32(out_1, mul, _mm512_unpackhi_epi16(pairs_0, pairs_1));
+#else
+        __m512i first = rows[idx], second = kZero;
+        uint16_t factor = input[idx];
+        if (nnue_next_index(&idx, &offset, &v, inMask, inDims)) {
+            second = rows[idx];
+            factor |= input[idx] << 8;
+        }
+        __m512i mul = _mm512_set1_epi16(factor);
+        __m512i prod = _mm512_maddubs_epi16(mul, _mm512_unpacklo_epi8(first, second));
+        __m512i signs = _mm512_srai_epi16(prod, 15);
+        out_0 = _mm512_add_epi32(out_0, _mm512_unpacklo_epi16(prod, signs));
+        out_1 = _mm512_add_epi32(out_1, _mm512_unpackhi_epi16(prod, signs));
+#endif
+    }
+
+    __m512i out16 = _mm512_srai_epi16(_mm512_packs_epi32(out_0, out_1), SHIFT);
+
+    const __m256i kZero256 = _mm256_setzero_si256();
+    __m256i *outVec = (__m256i *)output;
+    outVec[0] = _mm256_packs_epi16(_mm512_castsi512_si256(out16), _mm512_extracti64x4_epi64(out16, 1));
+    if (pack8_and_calc_mask)
+        outMask[0] = (uint32_t)_mm256_movemask_epi8(_mm256_cmpgt_epi8(outVec[0], kZero256));
+    else
+        outVec[0] = _mm256_max_epi8(outVec[0], kZero256);
+}
+#elif defined(USE_AVX2)
+static void nnue_affine_txfm(int8_t *input, void *output, unsigned inDims,
     unsigned outDims, const int32_t *biases, const weight_t *weights,
     mask_t *inMask, mask_t *outMask, const int pack8_and_calc_mask)
 {
@@ -477,7 +659,7 @@ void nnue_affine_txfm(int8_t *input, void *output, unsigned inDims,
         outVec[0] = _mm256_max_epi8(outVec[0], kZero);
 }
 #elif AVOID_USE_SSSE3
-void nnue_affine_txfm(int8_t *input, void *output, unsigned inDims,
+static void nnue_affine_txfm(int8_t *input, void *output, unsigned inDims,
     unsigned outDims, const int32_t *biases, const weight_t *weights,
     mask_t *inMask, mask_t *outMask, const bool pack8_and_calc_mask)
 {
@@ -553,7 +735,7 @@ void nnue_affine_txfm(int8_t *input, void *output, unsigned inDims,
     }
 }
 #elif defined(USE_SSE2)
-void nnue_affine_txfm(clipped_t *input, void *output, unsigned inDims,
+static void nnue_affine_txfm(clipped_t *input, void *output, unsigned inDims,
     unsigned outDims, const int32_t *biases, const weight_t *weights,
     mask_t *inMask, mask_t *outMask, const int pack8_and_calc_mask)
 {
@@ -617,7 +799,7 @@ void nnue_affine_txfm(clipped_t *input, void *output, unsigned inDims,
     }
 }
 #elif defined(USE_MMX)
-void nnue_affine_txfm(clipped_t *input, void *output, unsigned inDims,
+static void nnue_affine_txfm(clipped_t *input, void *output, unsigned inDims,
     unsigned outDims, const int32_t *biases, const weight_t *weights,
     mask_t *inMask, mask_t *outMask, const bool pack8_and_calc_mask)
 {
@@ -778,7 +960,7 @@ void nnue_affine_txfm(clipped_t *input, void *output, unsigned inDims,
 #endif
 }
 #elif defined(USE_NEON)
-void nnue_affine_txfm(clipped_t *input, void *output, unsigned inDims,
+static void nnue_affine_txfm(clipped_t *input, void *output, unsigned inDims,
     unsigned outDims, const int32_t *biases, const weight_t *weights,
     mask_t *inMask, mask_t *outMask, const bool pack8_and_calc_mask)
 {
@@ -842,7 +1024,7 @@ void nnue_affine_txfm(clipped_t *input, void *output, unsigned inDims,
     }
 }
 #else /* generic fallback */
-void nnue_affine_txfm(clipped_t *input, void *output, unsigned inDims,
+static void nnue_affine_txfm(clipped_t *input, void *output, unsigned inDims,
     unsigned outDims, int32_t *biases, const weight_t *weights,
     mask_t *inMask, mask_t *outMask, const int pack8_and_calc_mask)
 {
@@ -874,7 +1056,7 @@ void nnue_affine_txfm(clipped_t *input, void *output, unsigned inDims,
 //  Convert input features using updated accumulators
 //-------------------------------------------------------------------------------------------------
 // Convert input features
-void nnue_transform(NNUE_POSITION *pos, clipped_t *output, mask_t *outMask)
+static void nnue_transform(NNUE_POSITION *pos, clipped_t *output, mask_t *outMask)
 {
     int16_t(*accumulation)[2][256] = &pos->current_nnue_data->accumulator.accumulation;
     (void)outMask; // avoid compiler warning
@@ -905,7 +1087,7 @@ void nnue_transform(NNUE_POSITION *pos, clipped_t *output, mask_t *outMask)
 //-------------------------------------------------------------------------------------------------
 //  Network calculation, assume position is already updated, see calling method nnue_evaluate.
 //-------------------------------------------------------------------------------------------------
-int nnue_calculate(NNUE_POSITION *pos)
+int NNUE_KERNEL(nnue_calculate)(NNUE_POSITION *pos)
 {
     NNUE_CALC_DATA ncd;
 #ifdef _MSC_VER
@@ -915,10 +1097,11 @@ int nnue_calculate(NNUE_POSITION *pos)
     mask_t input_mask[FT_OUT_DIMS / (8 * sizeof(mask_t))] AL08;
     mask_t hidden1_mask[8 / sizeof(mask_t)] AL08 = { 0 };
 #endif
+    NNUE_PARAM *param = pos->param;
     nnue_transform(pos, ncd.input, input_mask);
-    nnue_affine_txfm(ncd.input, ncd.hidden1_out, FT_OUT_DIMS, 32, nnue_param.hidden1_biases, nnue_param.hidden1_weights, input_mask, hidden1_mask, TRUE);
-    nnue_affine_txfm(ncd.hidden1_out, ncd.hidden2_out, 32, 32, nnue_param.hidden2_biases, nnue_param.hidden2_weights, hidden1_mask, NULL, FALSE);
-    int32_t out_value = nnue_affine_propagate((int8_t *)ncd.hidden2_out, nnue_param.output_biases, nnue_param.output_weights);
+    nnue_affine_txfm(ncd.input, ncd.hidden1_out, FT_OUT_DIMS, 32, param->hidden1_biases, (weight_t *)param->hidden1_weights, input_mask, hidden1_mask, TRUE);
+    nnue_affine_txfm(ncd.hidden1_out, ncd.hidden2_out, 32, 32, param->hidden2_biases, (weight_t *)param->hidden2_weights, hidden1_mask, NULL, FALSE);
+    int32_t out_value = nnue_affine_propagate((int8_t *)ncd.hidden2_out, param->output_biases, (weight_t *)param->output_weights);
     return out_value / FV_SCALE;
 }
 
@@ -0,0 +1,35 @@
+/*-------------------------------------------------------------------------------
+  tucano is a chess playing engine developed by Alcides Schulz.
+  Copyright (C) 2011-present - Alcides Schulz
+
+  tucano is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  tucano is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You can find the GNU General Public License at http://www.gnu.org/licenses/
+-------------------------------------------------------------------------------*/
+
+//-------------------------------------------------------------------------------------------------
+//  NNUE kernel for AVX512 VNNI processors, used by the dispatch build (see nnue_dispatch.c).
+//-------------------------------------------------------------------------------------------------
+
+#if defined(USE_DISPATCH) && defined(__GNUC__) && defined(__x86_64__)
+#pragma GCC target("avx512f,avx512bw,avx512vl,avx512vnni,avx2,sse4.1,ssse3")
+#define USE_VNNI 1
+#define USE_AVX512 1
+#define USE_AVX2 1
+#define USE_SSE41 1
+#define USE_SSSE3 1
+#define USE_SSE2 1
+#define USE_SSE 1
+#define NNUE_KERNEL(name) name##_vnni
+#include "nnue_calc.c"
+#endif
+
+//END
@@ -41,7 +41,14 @@
 #endif
 //-------------------
 
-#if defined(USE_AVX2)
+#if defined(USE_AVX512)
+#include <immintrin.h>
+#if defined(USE_VNNI)
+#define NNUE_ARCH "AVX512-VNNI"
+#else
+#define NNUE_ARCH "AVX512"
+#endif
+#elif defined(USE_AVX2)
 #include <immintrin.h>
 #define NNUE_ARCH "AVX2"
 #elif defined(USE_SSE41)
@@ -139,6 +146,21 @@ typedef int16_t weight_t;
 typedef int8_t weight_t;
 #endif
 
+// Hidden and output weights are kept in the layout of the nnue kernel (nnue_calc.c): int8 or int16
+// weights, 32 or 64 bytes for each input. The size is the largest one, so all kernels use the same
+// parameters structure.
+#define WEIGHTS_ROW_SIZE 64
+
+// Kernel functions names. The dispatch build compiles nnue_calc.c for each instruction set, with
+// a suffix, and selects one of them at startup (see nnue_dispatch.c).
+#if !defined(NNUE_KERNEL)
+#if defined(USE_DISPATCH)
+#define NNUE_KERNEL(name) name##_base
+#else
+#define NNUE_KERNEL(name) name
+#endif
+#endif
+
 // Align options for MSC and GCC compilers
 #ifdef _MSC_VER
 #define AL64    __declspec(align(64))
@@ -161,9 +183,9 @@ typedef struct s_nnue_value {
 #ifdef _MSC_VER
     AL64 int16_t    ft_biases[KHALF_DIMENSIONS];
     AL64 int16_t    ft_weights[KHALF_DIMENSIONS * FT_IN_DIMS];
-    AL64 weight_t   hidden1_weights[32 * 512];
-    AL64 weight_t   hidden2_weights[32 * 32];
-    AL64 weight_t   output_weights[1 * 32];
+    AL64 int8_t     hidden1_weights[WEIGHTS_ROW_SIZE * 512];
+    AL64 int8_t     hidden2_weights[WEIGHTS_ROW_SIZE * 32];
+    AL64 int8_t     output_weights[1 * WEIGHTS_ROW_SIZE];
     AL64 int32_t    hidden1_biases[32];
     AL64 int32_t    hidden2_biases[32];
     int32_t         output_biases[1];
@@ -171,9 +193,9 @@ typedef struct s_nnue_value {
     // using align options for GCC
     int16_t         ft_biases[KHALF_DIMENSIONS] AL64;
     int16_t         ft_weights[KHALF_DIMENSIONS * FT_IN_DIMS] AL64;
-    weight_t        hidden1_weights[32 * 512] AL64;
-    weight_t        hidden2_weights[32 * 32] AL64;
-    weight_t        output_weights[1 * 32] AL64;
+    int8_t          hidden1_weights[WEIGHTS_ROW_SIZE * 512] AL64;
+    int8_t          hidden2_weights[WEIGHTS_ROW_SIZE * 32] AL64;
+    int8_t          output_weights[1 * WEIGHTS_ROW_SIZE] AL64;
     int32_t         hidden1_biases[32] AL64;
     int32_t         hidden2_biases[32] AL64;
     int32_t         output_biases[1];
@@ -206,7 +228,27 @@ typedef struct s_index_list {
     unsigned    values[30];
 }   NNUE_INDEXES;
 
+// Refresh cache ("finny tables"), one per thread: for each perspective and king square, the
+// accumulator of the last position refreshed with that king square and its pieces bitboards (by
+// nnue piece and square). A king move applies only the pieces that changed since then.
+typedef struct s_nnue_finny_entry {
+#ifdef _MSC_VER
+    AL64 int16_t accumulation[256];
+#else
+    int16_t     accumulation[256] AL64;
+#endif
+    uint64_t    pieces_bb[13];
+}   NNUE_FINNY_ENTRY;
+
+typedef struct s_nnue_finny {
+    NNUE_FINNY_ENTRY entry[2][64];
+    NNUE_PARAM* param;
+    int         net_version;
+}   NNUE_FINNY;
+
 typedef struct s_nnue_position {
+    NNUE_PARAM* param;
+    NNUE_FINNY* finny;
     int         player;
     int*        pieces;
     int*        squares;
@@ -234,6 +276,7 @@ typedef struct s_net_data {
 //  nnue global vars
 EXTERN NNUE_PARAM   nnue_param;
 EXTERN int nnue_data_loaded;
+EXTERN int nnue_net_version;
 
 #define TUCANO_EVAL_FILE "tucano_nn03.bin"
 
@@ -245,6 +288,9 @@ int8_t nnue_square(int square);
 void nnue_update_accumulator(NNUE_POSITION *pos);
 void nnue_refresh_accumulator(NNUE_POSITION *pos);
 int nnue_has_king_move(const NNUE_CHANGE *changes);
+void nnue_init_network(NNUE_PARAM *p_nnue_param, const char *d);
+uint32_t nnue_read_u32(const void *p);
+const char *nnue_arch(void);
 
 void nnue_test(void);
 
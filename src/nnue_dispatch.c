@@ -0,0 +1,130 @@
+/*-------------------------------------------------------------------------------
+  tucano is a chess playing engine developed by Alcides Schulz.
+  Copyright (C) 2011-present - Alcides Schulz
+
+  tucano is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  tucano is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You can find the GNU General Public License at http://www.gnu.org/licenses/
+-------------------------------------------------------------------------------*/
+
+#include "globals.h"
+
+//-------------------------------------------------------------------------------------------------
+//  NNUE kernel selection. Builds for one architecture (make avx2, sse4, ...) use the kernel of
+//  nnue_calc.c directly. The dispatch build (make dispatch) has kernels for several instruction
+//  sets (nnue_calc_*.c) and selects the best one for the cpu at startup, before the eval file is
+//  loaded, since the weights layout depends on the kernel.
+//-------------------------------------------------------------------------------------------------
+
+#if defined(USE_DISPATCH)
+
+#if !defined(__GNUC__)
+#error "dispatch build requires gcc or clang"
+#endif
+
+typedef struct s_nnue_kernel {
+    const char  *name;
+    void        (*refresh_accumulator)(NNUE_POSITION *pos);
+    void        (*update_accumulator)(NNUE_POSITION *pos);
+    int         (*calculate)(NNUE_POSITION *pos);
+    void        (*init_network)(NNUE_PARAM *p_nnue_param, const char *d);
+}   NNUE_KERNEL_TABLE;
+
+#define NNUE_KERNEL_DECLARE(isa) \
+    void nnue_refresh_accumulator_##isa(NNUE_POSITION *pos); \
+    void nnue_update_accumulator_##isa(NNUE_POSITION *pos); \
+    int nnue_calculate_##isa(NNUE_POSITION *pos); \
+    void nnue_init_network_##isa(NNUE_PARAM *p_nnue_param, const char *d);
+
+#define NNUE_KERNEL_ENTRY(isa, name) \
+    { name, nnue_refresh_accumulator_##isa, nnue_update_accumulator_##isa, nnue_calculate_##isa, nnue_init_network_##isa }
+
+NNUE_KERNEL_DECLARE(base)
+#if defined(__x86_64__)
+NNUE_KERNEL_DECLARE(vnni)
+NNUE_KERNEL_DECLARE(avx512)
+NNUE_KERNEL_DECLARE(avx2)
+NNUE_KERNEL_DECLARE(sse4)
+#endif
+
+enum NNUE_KERNELS {
+#if defined(__x86_64__)
+    KERNEL_VNNI, KERNEL_AVX512, KERNEL_AVX2, KERNEL_SSE4,
+#endif
+    KERNEL_BASE
+};
+
+static const NNUE_KERNEL_TABLE nnue_kernels[] = {
+#if defined(__x86_64__)
+    NNUE_KERNEL_ENTRY(vnni, "AVX512-VNNI (dispatch)"),
+    NNUE_KERNEL_ENTRY(avx512, "AVX512 (dispatch)"),
+    NNUE_KERNEL_ENTRY(avx2, "AVX2 (dispatch)"),
+    NNUE_KERNEL_ENTRY(sse4, "SSE41 (dispatch)"),
+#endif
+    NNUE_KERNEL_ENTRY(base, "BASE (dispatch)"),
+};
+
+static const NNUE_KERNEL_TABLE *nnue_kernel = &nnue_kernels[KERNEL_BASE];
+
+//-------------------------------------------------------------------------------------------------
+//  Select the kernel with the most recent instruction set supported by the cpu (and the os).
+//  Runs before main, so the kernel is known when the eval file is loaded.
+//-------------------------------------------------------------------------------------------------
+__attribute__((constructor)) static void nnue_select_kernel(void)
+{
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    int kernel = KERNEL_BASE;
+    if (__builtin_cpu_supports("sse4.1") && __builtin_cpu_supports("ssse3")) kernel = KERNEL_SSE4;
+    if (__builtin_cpu_supports("avx2")) kernel = KERNEL_AVX2;
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) {
+        kernel = KERNEL_AVX512;
+        if (__builtin_cpu_supports("avx512vl") && __builtin_cpu_supports("avx512vnni")) kernel = KERNEL_VNNI;
+    }
+    nnue_kernel = &nnue_kernels[kernel];
+#endif
+}
+
+void nnue_refresh_accumulator(NNUE_POSITION *pos)
+{
+    nnue_kernel->refresh_accumulator(pos);
+}
+
+void nnue_update_accumulator(NNUE_POSITION *pos)
+{
+    nnue_kernel->update_accumulator(pos);
+}
+
+int nnue_calculate(NNUE_POSITION *pos)
+{
+    return nnue_kernel->calculate(pos);
+}
+
+void nnue_init_network(NNUE_PARAM *p_nnue_param, const char *d)
+{
+    nnue_kernel->init_network(p_nnue_param, d);
+}
+
+const char *nnue_arch(void)
+{
+    return nnue_kernel->name;
+}
+
+#else
+
+const char *nnue_arch(void)
+{
+    return NNUE_ARCH;
+}
+
+#endif
+
+//END
@@ -49,20 +49,38 @@ int8_t nnue_square(int square)
 }
 
 //-------------------------------------------------------------------------------------------------
-//  Indicate if accumulators can be updated in this tree. Have to find a computed accumulator, and
-//  should not have king moves, that forces the accumulator refresh.
+//  Indicate a king move in the changed pieces, in this case will reset accumulators
 //-------------------------------------------------------------------------------------------------
-int nnue_can_update(BOARD *board)
+int nnue_has_king_move(const NNUE_CHANGE *changes)
 {
-    int history_ply = get_history_ply(board) - 1;
-    while (history_ply > 0) {
-        if (nnue_has_king_move(&board->nnue_data[history_ply].changes)) {
-            return FALSE;
+    for (int i = 0; i < changes->count; i++) {
+        if (NNUE_IS_KING(changes->piece[i])) {
+            return TRUE;
         }
-        if (board->nnue_data[history_ply].accumulator.computed == TRUE) {
+    }
+    return FALSE;
+}
+
+//-------------------------------------------------------------------------------------------------
+//  Indicate if accumulators can be updated in this tree. Have to find a computed accumulator in the
+//  accumulator stack, and should not have king moves, since the tree is updated with the piece
+//  lists of the current position (king squares included). A king move in the current position is
+//  updated only from the previous accumulator. Otherwise the accumulator refresh uses the refresh
+//  cache.
+//-------------------------------------------------------------------------------------------------
+int nnue_can_update(BOARD *board)
+{
+    int stack_ply = board->nnue_ply;
+    if (stack_ply > 0 && nnue_has_king_move(&board->nnue_data[stack_ply].changes)) {
+        return board->nnue_data[stack_ply - 1].accumulator.computed;
+    }
+    while (--stack_ply >= 0) {
+        if (board->nnue_data[stack_ply].accumulator.computed == TRUE) {
             return TRUE;
         }
-        history_ply--;
+        if (nnue_has_king_move(&board->nnue_data[stack_ply].changes)) {
+            return FALSE;
+        }
     }
     return FALSE;
 }
@@ -70,50 +88,204 @@ int nnue_can_update(BOARD *board)
 //-------------------------------------------------------------------------------------------------
 //  Update each accumulator in this tree, starting from a computed accumulator.
 //-------------------------------------------------------------------------------------------------
-void nnue_update_tree(BOARD *board, int history_ply, NNUE_POSITION *position)
+void nnue_update_tree(BOARD *board, int stack_ply, NNUE_POSITION *position)
 {
-    if (history_ply > 0) {
-        if (board->nnue_data[history_ply - 1].accumulator.computed == FALSE) {
-            nnue_update_tree(board, history_ply - 1, position);
+    if (stack_ply > 0) {
+        if (board->nnue_data[stack_ply - 1].accumulator.computed == FALSE) {
+            nnue_update_tree(board, stack_ply - 1, position);
         }
     }
-    if (history_ply == 0) {
+    if (stack_ply == 0) {
         position->current_nnue_data = &board->nnue_data[0];
         position->previous_nnue_data = NULL;
         nnue_refresh_accumulator(position);
         return;
     }
-    position->current_nnue_data = &board->nnue_data[history_ply];
-    position->previous_nnue_data = &board->nnue_data[history_ply - 1];
+    position->current_nnue_data = &board->nnue_data[stack_ply];
+    position->previous_nnue_data = &board->nnue_data[stack_ply - 1];
     nnue_update_accumulator(position);
 }
 
 //-------------------------------------------------------------------------------------------------
-//  Calculate current position score.
-//  If accumulators are not updated/computed then will use nnue data from move history to update.
+//  Copies of the network weights, one per numa node, so threads read the weights from local memory.
 //-------------------------------------------------------------------------------------------------
-int evaluate(GAME *game)
+typedef struct s_nnue_replica {
+    LARGE_MEMORY    memory;
+    int             numa_node;
+    THREAD_ID       thread_id;
+}   NNUE_REPLICA;
+
+NNUE_REPLICA    nnue_replicas[MAX_NUMA_NODES];
+int             nnue_replica_count = 0;
+
+//-------------------------------------------------------------------------------------------------
+//  Copy the weights by a thread running on the node, so memory is placed there (first touch).
+//-------------------------------------------------------------------------------------------------
+void *nnue_replica_copy(void *data)
 {
-    int score = 0;
+    NNUE_REPLICA *replica = (NNUE_REPLICA *)data;
 
-    EVAL_TABLE *eval_slot = game->eval_table + (board_key(&game->board) % EVAL_TABLE_SIZE);
-    if (eval_slot->key == board_key(&game->board)) {
-        return eval_slot->score;
+    util_numa_bind_thread(replica->numa_node);
+    if (!util_large_alloc(&replica->memory, sizeof(NNUE_PARAM))) {
+        replica->memory.address = NULL;
+        return NULL;
     }
+    memcpy(replica->memory.address, &nnue_param, sizeof(NNUE_PARAM));
+    return NULL;
+}
 
-    int player = side_on_move(&game->board);
-    int pieces[33];
-    int squares[33];
+//-------------------------------------------------------------------------------------------------
+//  Create the numa node copies of the weights when gNumaNnue is set and there are more nodes. Has
+//  to be called again when a new network is loaded.
+//-------------------------------------------------------------------------------------------------
+void nnue_replicas_init(void)
+{
+    for (int i = 0; i < nnue_replica_count; i++) {
+        util_large_free(&nnue_replicas[i].memory);
+    }
+    nnue_replica_count = 0;
+
+    int numa_nodes = MIN(util_numa_nodes(), MAX_NUMA_NODES);
+    if (!gNumaNnue || numa_nodes < 2 || !nnue_data_loaded) return;
+
+    // Threads are pinned to the nodes, so they are not taken from the pool.
+    for (int i = 0; i < numa_nodes; i++) {
+        nnue_replicas[i].numa_node = i;
+        THREAD_CREATE(nnue_replicas[i].thread_id, nnue_replica_copy, &nnue_replicas[i]);
+    }
+    for (int i = 0; i < numa_nodes; i++) {
+        THREAD_WAIT(nnue_replicas[i].thread_id);
+    }
+    nnue_replica_count = numa_nodes;
+    for (int i = 0; i < numa_nodes; i++) {
+        if (nnue_replicas[i].memory.address == NULL) {
+            fprintf(stderr, "no memory for network copy on numa node %d, using one copy.\n", i);
+            for (int j = 0; j < numa_nodes; j++) {
+                util_large_free(&nnue_replicas[j].memory);
+            }
+            nnue_replica_count = 0;
+            return;
+        }
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+//  Network weights for the current thread: the copy of its numa node, or the global one.
+//-------------------------------------------------------------------------------------------------
+NNUE_PARAM *nnue_thread_param(void)
+{
+    if (nnue_replica_count == 0) return &nnue_param;
+    int node = util_numa_current_node();
+    if (node < 0 || node >= nnue_replica_count) return &nnue_param;
+    return (NNUE_PARAM *)nnue_replicas[node].memory.address;
+}
+
+//-------------------------------------------------------------------------------------------------
+//  Evaluation caches: one per thread, or only the first one when shared.
+//-------------------------------------------------------------------------------------------------
+EVAL_CACHE  eval_caches[MAX_THREADS];
+int         eval_cache_count = 0;
+
+//-------------------------------------------------------------------------------------------------
+//  Clear an evaluation cache.
+//-------------------------------------------------------------------------------------------------
+void *eval_cache_clear(void *data)
+{
+    EVAL_CACHE *cache = (EVAL_CACHE *)data;
+    memset(cache->entry, 0, (cache->mask + 1) * sizeof(U64));
+    return NULL;
+}
+
+//-------------------------------------------------------------------------------------------------
+//  Allocate evaluation caches with gEvalCacheSize MB, rounded down to a power of two.
+//-------------------------------------------------------------------------------------------------
+void eval_cache_init(void)
+{
+    for (int i = 0; i < eval_cache_count; i++) {
+        ALIGNED_FREE(eval_caches[i].entry);
+        eval_caches[i].entry = NULL;
+        eval_caches[i].mask = 0;
+    }
+
+    size_t size = 1;
+    while (size * 2 <= (size_t)gEvalCacheSize) size *= 2;
+    size *= 1024 * 1024;
+
+    eval_cache_count = gEvalCacheShared ? 1 : gThreads;
+    for (int i = 0; i < eval_cache_count; i++) {
+        eval_caches[i].entry = (U64 *)ALIGNED_ALLOC(64, size);
+        if (eval_caches[i].entry == NULL) {
+            fprintf(stderr, "no memory for evaluation cache, size=%d MB, threads=%d !", gEvalCacheSize, eval_cache_count);
+            exit(-1);
+        }
+        eval_caches[i].mask = size / sizeof(U64) - 1;
+    }
+
+    // Each thread clears its own cache, so pages are placed on its numa node (first touch).
+    pool_run(eval_cache_count, eval_cache_clear, eval_caches, sizeof(EVAL_CACHE));
+}
+
+//-------------------------------------------------------------------------------------------------
+//  Clear the evaluation caches, e.g. when another network is loaded.
+//-------------------------------------------------------------------------------------------------
+void eval_cache_reset(void)
+{
+    pool_run(eval_cache_count, eval_cache_clear, eval_caches, sizeof(EVAL_CACHE));
+}
+
+//-------------------------------------------------------------------------------------------------
+//  Evaluation cache used by a search thread (0 is the main thread).
+//-------------------------------------------------------------------------------------------------
+EVAL_CACHE *eval_cache_thread(int thread_number)
+{
+    return &eval_caches[gEvalCacheShared ? 0 : thread_number];
+}
+
+//-------------------------------------------------------------------------------------------------
+//  Reset the refresh cache: each entry has the feature transformer biases, an empty position.
+//-------------------------------------------------------------------------------------------------
+void nnue_finny_reset(NNUE_FINNY *finny, NNUE_PARAM *param)
+{
+    for (int c = 0; c < 2; c++) {
+        for (int sq = 0; sq < 64; sq++) {
+            memcpy(finny->entry[c][sq].accumulation, param->ft_biases, sizeof(param->ft_biases));
+            memset(finny->entry[c][sq].pieces_bb, 0, sizeof(finny->entry[c][sq].pieces_bb));
+        }
+    }
+    finny->param = param;
+    finny->net_version = nnue_net_version;
+}
+
+//-------------------------------------------------------------------------------------------------
+//  Prepare the nnue position (piece lists) and bring the accumulator of the board position up to
+//  date. If accumulators are not updated/computed then will use nnue data from move history.
+//-------------------------------------------------------------------------------------------------
+void nnue_update_position(BOARD *board, NNUE_PARAM *param, NNUE_FINNY *finny, NNUE_POSITION *position, int *pieces, int *squares)
+{
+    int stack_ply = board->nnue_ply;
+
+    position->param = param;
+    position->finny = finny;
+    position->player = side_on_move(board);
+    position->pieces = pieces;
+    position->squares = squares;
+    position->current_nnue_data = &board->nnue_data[stack_ply];
+    position->previous_nnue_data = NULL;
+
+    // Accumulator already computed, e.g. by the eager update in make_move.
+    if (position->current_nnue_data->accumulator.computed == TRUE) {
+        return;
+    }
 
     pieces[0] = nnue_piece(WHITE, KING);
-    squares[0] = nnue_square(king_square(&game->board, WHITE));
+    squares[0] = nnue_square(king_square(board, WHITE));
     pieces[1] = nnue_piece(BLACK, KING);
-    squares[1] = nnue_square(king_square(&game->board, BLACK));
+    squares[1] = nnue_square(king_square(board, BLACK));
 
     int next_index = 2;
     for (int color = WHITE; color <= BLACK; color++) {
         for (int piece = QUEEN; piece >= PAWN; piece--) {
-            U64 pieces_bb = game->board.state[color].piece[piece];
+            U64 pieces_bb = board->state[color].piece[piece];
             while (pieces_bb) {
                 int square = bb_first_index(pieces_bb);
                 pieces[next_index] = nnue_piece(color, piece);
@@ -126,28 +298,94 @@ int evaluate(GAME *game)
     pieces[next_index] = 0;
     squares[next_index] = 0;
 
-    int history_ply = get_history_ply(&game->board);
-    
+    if (finny != NULL && (finny->param != param || finny->net_version != nnue_net_version)) {
+        nnue_finny_reset(finny, param);
+    }
+
+    if (nnue_can_update(board)) {
+        nnue_update_tree(board, stack_ply, position);
+        position->current_nnue_data = &board->nnue_data[stack_ply];
+        position->previous_nnue_data = NULL;
+    }
+    else {
+        nnue_refresh_accumulator(position);
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+//  Compute the accumulator of the current position, e.g. the root position given to helper
+//  threads. It is always refreshed, the network could have been loaded after it was computed.
+//-------------------------------------------------------------------------------------------------
+void nnue_compute_accumulator(BOARD *board)
+{
+    int pieces[33];
+    int squares[33];
+    NNUE_POSITION position;
+
+    board->nnue_data[board->nnue_ply].accumulator.computed = FALSE;
+    nnue_update_position(board, &nnue_param, NULL, &position, pieces, squares);
+}
+
+//-------------------------------------------------------------------------------------------------
+//  Eager update (NnueEager option): make_move updates the accumulator of the new position from the
+//  parent one, for both perspectives at once, and evaluate only runs the network layers. King
+//  moves, that refresh with the piece lists, and a parent without accumulator are left to evaluate.
+//-------------------------------------------------------------------------------------------------
+void nnue_eager_update(BOARD *board)
+{
+    NNUE_DATA *current = &board->nnue_data[board->nnue_ply];
+    NNUE_DATA *previous = &board->nnue_data[board->nnue_ply - 1];
+
+    if (previous->accumulator.computed == FALSE || nnue_has_king_move(&current->changes)) {
+        return;
+    }
+
+    // Only the king squares are needed to update the accumulators.
+    int pieces[3] = { nnue_piece(WHITE, KING), nnue_piece(BLACK, KING), 0 };
+    int squares[3] = { nnue_square(king_square(board, WHITE)), nnue_square(king_square(board, BLACK)), 0 };
     NNUE_POSITION position;
-    position.player = player;
+
+    position.param = board->nnue_eager;
+    position.finny = NULL;
+    position.player = side_on_move(board);
     position.pieces = pieces;
     position.squares = squares;
+    position.current_nnue_data = current;
+    position.previous_nnue_data = previous;
+    nnue_update_accumulator(&position);
+}
 
-    if (nnue_can_update(&game->board)) {
-        nnue_update_tree(&game->board, history_ply, &position);
-        position.current_nnue_data = &game->board.nnue_data[history_ply];
-        position.previous_nnue_data = NULL;
-    }
-    else {
-        position.current_nnue_data = &game->board.nnue_data[history_ply];
-        position.previous_nnue_data = NULL;
-        nnue_refresh_accumulator(&position);
+//-------------------------------------------------------------------------------------------------
+//  Calculate current position score.
+//  If accumulators are not updated/computed then will use nnue data from move history to update.
+//-------------------------------------------------------------------------------------------------
+int evaluate(GAME *game)
+{
+    int score = 0;
+
+    U64 *eval_entry = NULL;
+    U64 eval_key = board_key(&game->board) & ~(U64)0xFFFF;
+    if (game->eval_cache != NULL && game->eval_cache->entry != NULL) {
+        eval_entry = game->eval_cache->entry + (board_key(&game->board) & game->eval_cache->mask);
+        U64 cached = *eval_entry;
+        if ((cached & ~(U64)0xFFFF) == eval_key && cached != 0) {
+            TT_STATS_COUNT(game, eval_reads, 1);
+            return (S16)(U16)cached;
+        }
+        TT_STATS_COUNT(game, eval_reads, 0);
     }
 
+    int pieces[33];
+    int squares[33];
+    NNUE_POSITION position;
+
+    nnue_update_position(&game->board, game->nnue_param, &game->finny, &position, pieces, squares);
+
     score = nnue_calculate(&position);
 
-    eval_slot->key = board_key(&game->board);
-    eval_slot->score = score;
+    if (eval_entry != NULL && score >= -MAX_SCORE && score <= MAX_SCORE) {
+        *eval_entry = eval_key | (U16)score;
+    }
 
     return score;
 }
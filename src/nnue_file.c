@@ -103,87 +103,6 @@ int nnue_verify_net(const void *file_data, size_t size)
     return TRUE;
 }
 
-#ifdef USE_AVX2
-void nnue_permute_biases(int32_t *biases)
-{
-    __m128i *b = (__m128i *)biases;
-    __m128i tmp[8];
-#ifdef USE_AVX512
-    tmp[0] = b[0];
-    tmp[1] = b[2];
-    tmp[2] = b[4];
-    tmp[3] = b[6];
-    tmp[4] = b[1];
-    tmp[5] = b[3];
-    tmp[6] = b[5];
-    tmp[7] = b[7];
-#elif USE_AVX2
-    tmp[0] = b[0];
-    tmp[1] = b[4];
-    tmp[2] = b[1];
-    tmp[3] = b[5];
-    tmp[4] = b[2];
-    tmp[5] = b[6];
-    tmp[6] = b[3];
-    tmp[7] = b[7];
-#else
-#error
-#endif
-    memcpy(b, tmp, 8 * sizeof(__m128i));
-}
-#endif
-
-unsigned nnue_weight_index(unsigned r, unsigned c, unsigned dims)
-{
-    (void)dims;
-#if defined(USE_AVX512)
-    if (dims > 32) {
-        unsigned b = c & 0x38;
-        b = (b << 1) | (b >> 2);
-        c = (c & ~0x38) | (b & 0x38);
-    }
-    else if (dims == 32) {
-        unsigned b = c & 0x18;
-        b = (b << 1) | (b >> 1);
-        c = (c & ~0x18) | (b & 0x18);
-    }
-#elif defined(USE_AVX2)
-    if (dims > 32) {
-        unsigned b = c & 0x18;
-        b = (b << 1) | (b >> 1);
-        c = (c & ~0x18) | (b & 0x18);
-    }
-#endif
-#if defined(USE_AVX512)
-    return c * 64 + r + (r & ~7);
-#else
-    return c * 32 + r;
-#endif
-}
-
-const char *nnue_read_hidden_weights(weight_t *w, unsigned dims, const char *d)
-{
-    for (unsigned r = 0; r < 32; r++) {
-        for (unsigned c = 0; c < dims; c++) {
-            w[nnue_weight_index(r, c, dims)] = *d++;
-        }
-    }
-    return d;
-}
-
-void nnue_read_output_weights(weight_t *w, const char *d)
-{
-    for (unsigned i = 0; i < 32; i++) {
-        unsigned c = i;
-#if defined(USE_AVX512)
-        unsigned b = c & 0x18;
-        b = (b << 1) | (b >> 1);
-        c = (c & ~0x18) | (b & 0x18);
-#endif
-        w[c] = *d++;
-    }
-}
-
 void nnue_init_weights(const void *file_data, NNUE_PARAM *p_nnue_param)
 {
     const char *d = (const char *)file_data + TRANSFORMER_START + 4;
@@ -194,24 +113,9 @@ void nnue_init_weights(const void *file_data, NNUE_PARAM *p_nnue_param)
     for (unsigned i = 0; i < KHALF_DIMENSIONS * FT_IN_DIMS; i++, d += 2) {
         p_nnue_param->ft_weights[i] = nnue_read_u16(d);
     }
-    // Read network
+    // Read network, in the layout of the nnue kernel
     d += 4;
-    for (unsigned i = 0; i < 32; i++, d += 4) {
-        p_nnue_param->hidden1_biases[i] = nnue_read_u32(d);
-    }
-    d = nnue_read_hidden_weights(p_nnue_param->hidden1_weights, 512, d);
-    for (unsigned i = 0; i < 32; i++, d += 4) {
-        p_nnue_param->hidden2_biases[i] = nnue_read_u32(d);
-    }
-    d = nnue_read_hidden_weights(p_nnue_param->hidden2_weights, 32, d);
-    for (unsigned i = 0; i < 1; i++, d += 4) {
-        p_nnue_param->output_biases[i] = nnue_read_u32(d);
-    }
-    nnue_read_output_weights(p_nnue_param->output_weights, d);
-#ifdef USE_AVX2
-    nnue_permute_biases(p_nnue_param->hidden1_biases);
-    nnue_permute_biases(p_nnue_param->hidden2_biases);
-#endif
+    nnue_init_network(p_nnue_param, d);
 }
 
 int nnue_load_eval_file(const char *eval_file, NNUE_PARAM *p_nnue_param)
@@ -237,6 +141,7 @@ int nnue_load_eval_file(const char *eval_file, NNUE_PARAM *p_nnue_param)
 int nnue_init(const char* eval_file_name, NNUE_PARAM *p_nnue_param)
 {
     if (nnue_load_eval_file(eval_file_name, p_nnue_param)) {
+        nnue_net_version++;
         printf("\nEval file '%s' loaded !\n", eval_file_name);
         fflush(stdout);
         return TRUE;
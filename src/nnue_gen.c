@@ -77,6 +77,8 @@ void generate_nn_data(int fen_total, int max_depth, int max_nodes, char *output_
     settings.post_flag = POST_NONE;
     settings.use_book = FALSE;
     settings.max_nodes = max_nodes;
+    settings.search_moves_count = 0;
+    settings.mate = 0;
 
     FILE *output = fopen(output_filename, "w");
 
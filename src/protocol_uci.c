@@ -23,9 +23,8 @@ You can find the GNU General Public License at http://www.gnu.org/licenses/
 
 char    uci_line[MAX_READ];
 char    go_line[MAX_READ];
+char    uci_hash_file[MAX_READ] = "";
 
-volatile int uci_is_pondering = FALSE;
-volatile int uci_is_infinite = FALSE;
 volatile int search_setup_complete = FALSE;
 
 void *execute_uci_go(void *line);
@@ -34,8 +33,19 @@ void remove_line_feed_chars(char *line);
 
 #define HASH_OPTION_STRING "setoption name Hash value "
 #define THREADS_OPTION_STRING "setoption name Threads value "
+#define MULTI_PV_OPTION_STRING "setoption name MultiPV value "
+#define AFFINITY_OPTION_STRING "setoption name Affinity value "
+#define NUMA_HASH_OPTION_STRING "setoption name NumaHash value "
+#define NUMA_NNUE_OPTION_STRING "setoption name NumaNnue value "
+#define NNUE_EAGER_OPTION_STRING "setoption name NnueEager value "
+#define TT_STATS_OPTION_STRING "setoption name TTStats value "
+#define EVAL_CACHE_OPTION_STRING "setoption name EvalCache value "
+#define EVAL_CACHE_SHARED_OPTION_STRING "setoption name EvalCacheShared value "
 #define SYZYGY_OPTION_STRING "setoption name SyzygyPath value "
 #define EVAL_FILE_OPTION_STRING "setoption name EvalFile value "
+#define HASH_FILE_OPTION_STRING "setoption name HashFile value "
+#define SAVE_HASH_FILE_OPTION_STRING "setoption name SaveHashFile"
+#define LOAD_HASH_FILE_OPTION_STRING "setoption name LoadHashFile"
 
 //-------------------------------------------------------------------------------------------------
 //    UCI main loop.
@@ -43,17 +53,33 @@ void remove_line_feed_chars(char *line);
 void uci_loop(char *engine_name, char *engine_version, char *engine_author) {
     
     THREAD_ID go_thread = 0;
+    int go_running = FALSE;
 
     // UCI initialization
     printf("id name %s %s\n", engine_name, engine_version);
     printf("id author %s\n", engine_author);
     printf("option name Hash type spin default 64 min %d max %d\n", MIN_HASH_SIZE, MAX_HASH_SIZE);
     printf("option name Threads type spin default 1 min %d max %d\n", MIN_THREADS, MAX_THREADS);
+    printf("option name MultiPV type spin default 1 min %d max %d\n", MIN_MULTI_PV, MAX_MULTI_PV);
+    printf("option name Affinity type string default none\n");
+    printf("option name NumaHash type check default false\n");
+    printf("option name NumaNnue type check default false\n");
+    printf("option name NnueEager type check default false\n");
+    printf("option name TTStats type check default false\n");
+    printf("option name EvalCache type spin default 1 min %d max %d\n", MIN_EVAL_CACHE_SIZE, MAX_EVAL_CACHE_SIZE);
+    printf("option name EvalCacheShared type check default false\n");
     printf("option name SyzygyPath type string default <empty>\n");
     printf("option name Ponder type check default false\n");
     printf("option name EvalFile type string default <empty>\n");
+    printf("option name HashFile type string default <empty>\n");
+    printf("option name SaveHashFile type button\n");
+    printf("option name LoadHashFile type button\n");
 
     printf("uciok\n");
+
+    char memory_info[200];
+    tt_memory_info(memory_info);
+    printf("info string %s\n", memory_info);
     
     while (TRUE) {
 
@@ -75,18 +101,76 @@ void uci_loop(char *engine_name, char *engine_version, char *engine_author) {
 
         if (!strncmp(uci_line, HASH_OPTION_STRING, strlen(HASH_OPTION_STRING))) {
             gHashSize = valid_hash_size(atoi(&uci_line[strlen(HASH_OPTION_STRING)]));
-            tt_init();
+            if (!tt_resize()) printf("info string no memory for Hash %s MB\n", &uci_line[strlen(HASH_OPTION_STRING)]);
             printf("info string Hash set to %d MB\n", gHashSize);
+            tt_memory_info(memory_info);
+            printf("info string %s\n", memory_info);
+            continue;
+        }
+
+        if (!strncmp(uci_line, NUMA_HASH_OPTION_STRING, strlen(NUMA_HASH_OPTION_STRING))) {
+            gNumaHash = !strcmp(&uci_line[strlen(NUMA_HASH_OPTION_STRING)], "true");
+            tt_init();
+            tt_memory_info(memory_info);
+            printf("info string %s\n", memory_info);
+            continue;
+        }
+
+        if (!strncmp(uci_line, AFFINITY_OPTION_STRING, strlen(AFFINITY_OPTION_STRING))) {
+            if (!threads_affinity(&uci_line[strlen(AFFINITY_OPTION_STRING)])) {
+                printf("info string invalid Affinity %s\n", &uci_line[strlen(AFFINITY_OPTION_STRING)]);
+                continue;
+            }
+            threads_init();
+            eval_cache_init();
+            printf("info string Affinity set to %s\n", threads_affinity_name());
+            continue;
+        }
+
+        if (!strncmp(uci_line, NNUE_EAGER_OPTION_STRING, strlen(NNUE_EAGER_OPTION_STRING))) {
+            gNnueEager = !strcmp(&uci_line[strlen(NNUE_EAGER_OPTION_STRING)], "true");
+            continue;
+        }
+
+        if (!strncmp(uci_line, NUMA_NNUE_OPTION_STRING, strlen(NUMA_NNUE_OPTION_STRING))) {
+            gNumaNnue = !strcmp(&uci_line[strlen(NUMA_NNUE_OPTION_STRING)], "true");
+            nnue_replicas_init();
+            main_game.nnue_param = nnue_thread_param();
             continue;
         }
 
         if (!strncmp(uci_line, THREADS_OPTION_STRING, strlen(THREADS_OPTION_STRING))) {
             gThreads = valid_threads(atoi(&uci_line[strlen(THREADS_OPTION_STRING)]));
             threads_init();
+            eval_cache_init();
             printf("info string Threads set to %d\n", gThreads);
             continue;
         }
 
+        if (!strncmp(uci_line, MULTI_PV_OPTION_STRING, strlen(MULTI_PV_OPTION_STRING))) {
+            gMultiPV = atoi(&uci_line[strlen(MULTI_PV_OPTION_STRING)]);
+            gMultiPV = MAX(MIN_MULTI_PV, MIN(gMultiPV, MAX_MULTI_PV));
+            continue;
+        }
+
+        if (!strncmp(uci_line, EVAL_CACHE_OPTION_STRING, strlen(EVAL_CACHE_OPTION_STRING))) {
+            gEvalCacheSize = atoi(&uci_line[strlen(EVAL_CACHE_OPTION_STRING)]);
+            gEvalCacheSize = MAX(MIN_EVAL_CACHE_SIZE, MIN(gEvalCacheSize, MAX_EVAL_CACHE_SIZE));
+            eval_cache_init();
+            continue;
+        }
+
+        if (!strncmp(uci_line, EVAL_CACHE_SHARED_OPTION_STRING, strlen(EVAL_CACHE_SHARED_OPTION_STRING))) {
+            gEvalCacheShared = !strcmp(&uci_line[strlen(EVAL_CACHE_SHARED_OPTION_STRING)], "true");
+            eval_cache_init();
+            continue;
+        }
+
+        if (!strncmp(uci_line, TT_STATS_OPTION_STRING, strlen(TT_STATS_OPTION_STRING))) {
+            gTTStats = !strcmp(&uci_line[strlen(TT_STATS_OPTION_STRING)], "true");
+            continue;
+        }
+
 #ifdef EGTB_SYZYGY
         if (!strncmp(uci_line, SYZYGY_OPTION_STRING, strlen(SYZYGY_OPTION_STRING))) {
             char *syzygy_path = &uci_line[strlen(SYZYGY_OPTION_STRING)];
@@ -101,8 +185,35 @@ void uci_loop(char *engine_name, char *engine_version, char *engine_author) {
         if (!strncmp(uci_line, EVAL_FILE_OPTION_STRING, strlen(EVAL_FILE_OPTION_STRING))) {
             char *eval_file = &uci_line[strlen(EVAL_FILE_OPTION_STRING)];
             if (strlen(eval_file) && strcmp(eval_file, "<empty>")) {
-                nnue_init(eval_file, &nnue_param);
+                if (nnue_init(eval_file, &nnue_param)) {
+                    nnue_data_loaded = TRUE;
+                    nnue_replicas_init();
+                    main_game.nnue_param = nnue_thread_param();
+                    // Cached evaluations and search results come from the previous network.
+                    eval_cache_reset();
+                    tt_clear();
+                }
+            }
+            continue;
+        }
+
+        if (!strncmp(uci_line, HASH_FILE_OPTION_STRING, strlen(HASH_FILE_OPTION_STRING))) {
+            char *hash_file = &uci_line[strlen(HASH_FILE_OPTION_STRING)];
+            strcpy(uci_hash_file, strcmp(hash_file, "<empty>") ? hash_file : "");
+            continue;
+        }
+
+        if (!strcmp(uci_line, SAVE_HASH_FILE_OPTION_STRING) || !strcmp(uci_line, LOAD_HASH_FILE_OPTION_STRING)) {
+            int save = !strcmp(uci_line, SAVE_HASH_FILE_OPTION_STRING);
+            if (!strlen(uci_hash_file)) {
+                printf("info string HashFile is not set\n");
+                continue;
             }
+            char *error = save ? tt_save_file(uci_hash_file) : tt_load_file(uci_hash_file);
+            if (error == NULL)
+                printf("info string hash file %s %s, Hash %d MB\n", uci_hash_file, save ? "saved" : "loaded", gHashSize);
+            else
+                printf("info string hash file error: %s: %s\n", error, uci_hash_file);
             continue;
         }
 
@@ -112,33 +223,41 @@ void uci_loop(char *engine_name, char *engine_version, char *engine_author) {
         }
 
         if (!strncmp(uci_line, "go", 2)) {
-            uci_is_infinite = FALSE;
-            uci_is_pondering = FALSE;
+            if (go_running) THREAD_WAIT(go_thread); // previous search already sent bestmove
+            search_signal_clear(SIGNAL_PONDER | SIGNAL_INFINITE);
             // execute the go command in a new thread
             strcpy(go_line, uci_line);
             search_setup_complete = FALSE;
             THREAD_CREATE(go_thread, execute_uci_go, go_line);
+            go_running = TRUE;
             continue;
         }
 
         if (!strcmp(uci_line, "ponderhit")) {
+            if (!go_running) continue;
             while (!search_setup_complete) { util_sleep(1); }
-            uci_is_pondering = FALSE; // stop pondering but search can continue
+            search_signal_clear(SIGNAL_PONDER); // stop pondering but search can continue
             THREAD_WAIT(go_thread);
+            go_running = FALSE;
             continue;
         }
 
-        if (!strcmp(uci_line, "stop")) {
-            while (!search_setup_complete) { util_sleep(1); }
-            main_game.search.abort = TRUE;
-            uci_is_infinite = FALSE;
-            uci_is_pondering = FALSE;
-            THREAD_WAIT(go_thread);
+        if (!strcmp(uci_line, "stop") || !strcmp(uci_line, "quit")) {
+            if (go_running) {
+                while (!search_setup_complete) { util_sleep(1); }
+                search_signal(SIGNAL_STOP);
+                search_signal_clear(SIGNAL_PONDER | SIGNAL_INFINITE);
+                THREAD_WAIT(go_thread);
+                search_signal_clear(SIGNAL_STOP);
+                go_running = FALSE;
+            }
+            if (!strcmp(uci_line, "quit")) break;
             continue;
         }
 
-        if (!strcmp(uci_line, "quit")) {
-            break;
+        if (!strncmp(uci_line, "debug", 5)) {
+            gDebug = !strcmp(uci_line, "debug on");
+            continue;
         }
     }
 }
@@ -154,7 +273,8 @@ void uci_loop(char *engine_name, char *engine_version, char *engine_author) {
 //    * movestogo <x>
 //    * depth <x>
 //    * nodes <x>
-//    * mate <x>
+//    * mate <x>: stop condition, the search ends when a mate in x moves is found. It is not
+//      a dedicated mate search, pruning is the same, so a mate may be found late or not at all.
 //    * movetime <x>
 //    * infinite
 //-------------------------------------------------------------------------------------------------
@@ -170,10 +290,22 @@ void *execute_uci_go(void *pv_line)
     int binc = -1;
     int move_time = -1;
     U64 max_nodes = 0;
+    int mate = 0;
+    MOVE search_moves[MAX_MOVE];
+    int search_moves_count = 0;
 
     char *token = strtok((char *)pv_line, " "); // skip "go "
 
     for (token = strtok(NULL, " "); token != NULL; token = strtok(NULL, " ")) {
+        if (!strcmp(token, "searchmoves")) {
+            // moves list ends at the next token that is not a move
+            for (token = strtok(NULL, " "); token != NULL; token = strtok(NULL, " ")) {
+                MOVE move = util_parse_move(&main_game, token);
+                if (move == MOVE_NONE) break;
+                if (search_moves_count < MAX_MOVE) search_moves[search_moves_count++] = move;
+            }
+            if (token == NULL) break;
+        }
         if (!strcmp(token, "wtime")) {
             wtime = atoi(strtok(NULL, " "));
             continue;
@@ -198,6 +330,10 @@ void *execute_uci_go(void *pv_line)
             max_nodes = atoll(strtok(NULL, " "));
             continue;
         }
+        if (!strcmp(token, "mate")) {
+            mate = atoi(strtok(NULL, " "));
+            continue;
+        }
         if (!strcmp(token, "infinite")) {
             infinite = TRUE;
             continue;
@@ -224,6 +360,8 @@ void *execute_uci_go(void *pv_line)
     game_settings.increment_time = 0;
     game_settings.moves_to_go = 0;
     game_settings.max_nodes = 0;
+    game_settings.search_moves_count = 0;
+    game_settings.mate = 0;
 
     int total_time = side_on_move(&main_game.board) == WHITE ? wtime : btime;
     int inc_time = side_on_move(&main_game.board) == WHITE ? winc : binc;
@@ -233,26 +371,30 @@ void *execute_uci_go(void *pv_line)
     if (inc_time != -1) game_settings.increment_time = inc_time;
     if (move_time != -1) game_settings.single_move_time = move_time;
     if (moves_to_go != -1) game_settings.moves_to_go = moves_to_go;
-    if (ponder) uci_is_pondering = TRUE;
-    if (infinite) uci_is_infinite = TRUE;
-    if (uci_is_infinite) game_settings.single_move_time = MAX_TIME;
+    if (ponder) search_signal(SIGNAL_PONDER);
+    if (infinite) search_signal(SIGNAL_INFINITE);
+    if (infinite) game_settings.single_move_time = MAX_TIME;
     if (max_nodes != 0) game_settings.max_nodes = max_nodes;
+    game_settings.search_moves_count = search_moves_count;
+    memcpy(game_settings.search_moves, search_moves, sizeof(MOVE) * search_moves_count);
+    if (mate > 0) {
+        game_settings.mate = mate;
+        // without time control the search runs until the mate is found or a stop command.
+        if (total_time == -1 && move_time == -1) game_settings.single_move_time = MAX_TIME;
+    }
 
     search_setup_complete = TRUE;
 
     // search
     search_run(&main_game, &game_settings);
 
-    // Ponder: if search finish early have to wait for stop or ponderhit commands from uci
-    while (uci_is_pondering) { 
-        util_sleep(1);
+    if (gDebug) {
+        printf("info string stop latency %u us\n", main_game.search.stop_latency);
     }
 
-    // Infinite: if search finish early have to wait for stop command from uci
-    if (uci_is_infinite) { 
-        while (!main_game.search.abort) { 
-            util_sleep(1);
-        } 
+    // Ponder or infinite: if search finish early have to wait for ponderhit or stop commands from uci
+    while (search_signals() & (SIGNAL_PONDER | SIGNAL_INFINITE)) {
+        util_sleep(1);
     }
 
     // make and print best move found
@@ -63,16 +63,21 @@ int search(GAME *game, UINT incheck, int alpha, int beta, int depth, MOVE exclud
 
     // transposition table score or move hint
     TT_RECORD tt_record;
-    tt_read(game->board.key, &tt_record);
+    int tt_eval;
+    int tt_result = tt_read(game->board.key, &tt_record, &tt_eval);
+    TT_STATS_COUNT(game, reads, tt_result);
     if (!pv_node && tt_record.data && tt_record.info.depth >= depth && exclude_move == MOVE_NONE) {
         int score = score_from_tt(tt_record.info.score, ply);
         if (tt_record.info.flag == TT_EXACT) {
+            TT_STATS_COUNT(game, cutoffs, tt_record.info.flag);
             return score;
         }
         if (score >= beta && tt_record.info.flag == TT_LOWER) {
+            TT_STATS_COUNT(game, cutoffs, tt_record.info.flag);
             return score;
         }
         if (score <= alpha && tt_record.info.flag == TT_UPPER) {
+            TT_STATS_COUNT(game, cutoffs, tt_record.info.flag);
             return score;
         }
     }
@@ -105,7 +110,8 @@ int search(GAME *game, UINT incheck, int alpha, int beta, int depth, MOVE exclud
                 tt_record.info.depth = (S8)depth;
                 tt_record.info.flag = tt_flag;
                 tt_record.info.score = score_to_tt(score, ply);
-                tt_save(game->board.key, &tt_record);
+                tt_result = tt_save(game->board.key, &tt_record, tt_eval);
+                TT_STATS_COUNT(game, saves, tt_result);
                 return score;
             }
             // save egtb  min/max to adjust search scores later.
@@ -122,7 +128,12 @@ int search(GAME *game, UINT incheck, int alpha, int beta, int depth, MOVE exclud
 #endif 
 
     // Capture current eval and verify if this line is improving the score.
-    int eval_score = evaluate(game);
+    // The evaluation stored in the transposition table by any thread is used when available.
+    int eval_score = tt_eval;
+    if (eval_score == TT_EVAL_NONE) {
+        eval_score = evaluate(game);
+        tt_save_eval(game->board.key, eval_score);
+    }
     game->eval_hist[ply] = eval_score;
     int improving = ply > 1 && game->eval_hist[ply] > game->eval_hist[ply - 2];
     int opponent_worsening = ply > 0 && game->eval_hist[ply] > -game->eval_hist[ply - 1];
@@ -210,7 +221,8 @@ int search(GAME *game, UINT incheck, int alpha, int beta, int depth, MOVE exclud
                                 tt_record.info.depth = (S8)(depth - 3);
                                 tt_record.info.flag = TT_LOWER;
                                 tt_record.info.score = score_to_tt(pc_score, ply);
-                                tt_save(game->board.key, &tt_record);
+                                tt_result = tt_save(game->board.key, &tt_record, eval_score);
+                                TT_STATS_COUNT(game, saves, tt_result);
                             }
                             return pc_score;
                         }
@@ -241,6 +253,9 @@ int search(GAME *game, UINT incheck, int alpha, int beta, int depth, MOVE exclud
     int         move_count = 0;
     MOVE        move;
 
+    // Positions searched are marked in the busy table while other threads are running.
+    int         use_busy = gThreads > 1 && depth >= BUSY_MIN_DEPTH && exclude_move == MOVE_NONE;
+
     select_init(&ml, game, incheck, trans_move, FALSE);
     while ((move = next_move(&ml)) != MOVE_NONE) {
 
@@ -249,6 +264,7 @@ int search(GAME *game, UINT incheck, int alpha, int beta, int depth, MOVE exclud
         if (move == exclude_move) continue;
 
         if (!is_pseudo_legal(&game->board, ml.pins, move)) continue;
+        if (root_node && is_root_excluded(game, move)) continue;
 #ifdef TUCANO_COMPOSITION
         if (move == game->search.exclude) continue;
 #endif
@@ -357,6 +373,8 @@ int search(GAME *game, UINT incheck, int alpha, int beta, int depth, MOVE exclud
 
         assert(valid_is_legal(&game->board, move));
 
+        int busy_marked = use_busy ? busy_enter(game->board.key, depth) : FALSE;
+
         if (move_count == 1) {
             score = -search(game, gives_check, -beta, -alpha, depth - 1 + extensions, MOVE_NONE);
         }
@@ -372,6 +390,7 @@ int search(GAME *game, UINT incheck, int alpha, int beta, int depth, MOVE exclud
             }
         }
 
+        if (busy_marked) busy_leave(game->board.key, depth);
         undo_move(&game->board);
         if (game->search.abort) return 0;
 
@@ -379,7 +398,7 @@ int search(GAME *game, UINT incheck, int alpha, int beta, int depth, MOVE exclud
         if (score > best_score) {
             if (score > alpha) {
                 update_pv(&game->pv_line, ply, move);
-                if (root_node) {
+                if (root_node && game->search.multi_pv == 1) {
                     post_info(game, score, depth);
                 }
                 alpha = score;
@@ -397,7 +416,8 @@ int search(GAME *game, UINT incheck, int alpha, int beta, int depth, MOVE exclud
                         tt_record.info.depth = (S8)depth;
                         tt_record.info.flag = TT_LOWER;
                         tt_record.info.score = score_to_tt(score, ply);
-                        tt_save(game->board.key, &tt_record);
+                        tt_result = tt_save(game->board.key, &tt_record, eval_score);
+                        TT_STATS_COUNT(game, saves, tt_result);
                     }
                     return score;
                 }
@@ -434,7 +454,8 @@ int search(GAME *game, UINT incheck, int alpha, int beta, int depth, MOVE exclud
             tt_record.info.flag = TT_UPPER;
             tt_record.info.score = score_to_tt(best_score, ply);
         }
-        tt_save(game->board.key, &tt_record);
+        tt_result = tt_save(game->board.key, &tt_record, eval_score);
+        TT_STATS_COUNT(game, saves, tt_result);
     }
 
     return best_score;
@@ -0,0 +1,62 @@
+/*-------------------------------------------------------------------------------
+  tucano is a chess playing engine developed by Alcides Schulz.
+  Copyright (C) 2011-present - Alcides Schulz
+
+  tucano is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  tucano is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You can find the GNU General Public License at http://www.gnu.org/licenses/
+-------------------------------------------------------------------------------*/
+
+#include "globals.h"
+
+//-------------------------------------------------------------------------------------------------
+//  Positions being searched now by some thread, at a depth. Threads mark the positions they search,
+//  the table does not change the search yet: deferring the moves of helpers to positions another
+//  thread is searching (ABDADA idea) was slower in the tests made. Entries are single words: the
+//  upper key bits and the depth. Races only lose or keep an extra mark.
+//-------------------------------------------------------------------------------------------------
+
+#define BUSY_SIZE   16384   // entries, power of two
+#define BUSY_MASK   (BUSY_SIZE - 1)
+
+ATOMIC_U64  busy_table[BUSY_SIZE];
+
+//-------------------------------------------------------------------------------------------------
+//  Entry value for a position and depth.
+//-------------------------------------------------------------------------------------------------
+static U64 busy_entry(U64 key, int depth)
+{
+    return (key & ~(U64)0xFF) | (U64)(depth & 0xFF);
+}
+
+//-------------------------------------------------------------------------------------------------
+//  Mark the position as being searched. Returns TRUE when marked, then busy_leave has to be called
+//  when the search of the position ends.
+//-------------------------------------------------------------------------------------------------
+int busy_enter(U64 key, int depth)
+{
+    U64 entry = busy_entry(key, depth);
+    if (ATOMIC_LOAD64(busy_table[key & BUSY_MASK]) == entry) return FALSE;
+    ATOMIC_STORE64(busy_table[key & BUSY_MASK], entry);
+    return TRUE;
+}
+
+//-------------------------------------------------------------------------------------------------
+//  Remove the mark, if it was not replaced by another position.
+//-------------------------------------------------------------------------------------------------
+void busy_leave(U64 key, int depth)
+{
+    if (ATOMIC_LOAD64(busy_table[key & BUSY_MASK]) == busy_entry(key, depth)) {
+        ATOMIC_STORE64(busy_table[key & BUSY_MASK], 0);
+    }
+}
+
+//END
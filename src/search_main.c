@@ -22,31 +22,217 @@
 //-------------------------------------------------------------------------------------------------
 
 int     search_asp(GAME *game_data, int incheck, int depth, int prev_score);
+int     search_multi_pv(GAME *game, int incheck, int depth);
+void    set_root_exclude(GAME *game);
+void    publish_root_exclude(GAME *game);
+void    publish_helper_line(GAME *game);
+void    merge_helper_lines(GAME *game, int depth);
 void    *iterative_deepening(void *pv_game);
+void    set_best_move(GAME *game);
+void    select_best_thread(GAME *game);
+MOVE    count_root_moves(GAME *game, int incheck);
 
-GAME    *thread_data = NULL;
+GAME    *thread_data[MAX_THREADS];
+int     thread_index[MAX_THREADS];
 int     additional_threads = 0;
 
+// Multi pv data shared by the threads, under multi_pv_mutex: root moves of the lines from the last
+// iteration of the main thread, read by helpers, and the last completed line of each helper, merged
+// by the main thread.
+typedef struct s_helper_line {
+    MOVE    line[MAX_PLY];
+    int     size;
+    int     score;
+    int     depth;
+}   HELPER_LINE;
+
+MUTEX       multi_pv_mutex;
+MOVE        root_exclude_moves[MAX_MULTI_PV];
+int         root_exclude_moves_count = 0;
+HELPER_LINE helper_lines[MAX_THREADS];
+
+ATOMIC_INT  signals = 0;
+U64         stop_request_time = 0;
+
+int     affinity_list[MAX_CPUS];
+int     affinity_list_count = 0;
+char    affinity_name[256] = "none";
+int     affinity_bound = FALSE;
+
+//-------------------------------------------------------------------------------------------------
+//  Set search signals. A stop request is polled by all threads in check_time. The stop is cleared
+//  when the search finishes, or by the caller after the search thread ends.
+//-------------------------------------------------------------------------------------------------
+void search_signal(int signal)
+{
+    if ((signal & SIGNAL_STOP) && !(ATOMIC_LOAD(signals) & SIGNAL_STOP)) {
+        stop_request_time = util_get_time_us();
+    }
+    ATOMIC_OR(signals, signal);
+}
+
+//-------------------------------------------------------------------------------------------------
+//  Clear search signals.
+//-------------------------------------------------------------------------------------------------
+void search_signal_clear(int signal)
+{
+    ATOMIC_AND(signals, ~signal);
+}
+
 //-------------------------------------------------------------------------------------------------
-//  Create threads data.
+//  Current search signals.
+//-------------------------------------------------------------------------------------------------
+int search_signals(void)
+{
+    return ATOMIC_LOAD(signals);
+}
+
+//-------------------------------------------------------------------------------------------------
+//  Set the cpu affinity policy: none, compact, scatter, numa, or a list of cpus like "0,2,8-15".
+//  Returns FALSE for an invalid policy. Threads are bound when they are created (threads_init) or
+//  when a search starts (main thread).
+//-------------------------------------------------------------------------------------------------
+int threads_affinity(char *policy)
+{
+    int type = AFFINITY_LIST;
+
+    if (!strcmp(policy, "none")) type = AFFINITY_NONE;
+    if (!strcmp(policy, "compact")) type = AFFINITY_COMPACT;
+    if (!strcmp(policy, "scatter")) type = AFFINITY_SCATTER;
+    if (!strcmp(policy, "numa")) type = AFFINITY_NUMA;
+
+    if (type == AFFINITY_LIST) {
+        int count = 0;
+        char *c = policy;
+        while (*c) {
+            if (!isdigit(*c)) return FALSE;
+            int first_cpu = (int)strtol(c, &c, 10);
+            int last_cpu = first_cpu;
+            if (*c == '-') {
+                if (!isdigit(*++c)) return FALSE;
+                last_cpu = (int)strtol(c, &c, 10);
+            }
+            if (last_cpu < first_cpu || last_cpu >= MAX_CPUS) return FALSE;
+            if (*c == ',' && isdigit(c[1])) c++;
+            else if (*c) return FALSE;
+            for (int cpu = first_cpu; cpu <= last_cpu && count < MAX_CPUS; cpu++) {
+                affinity_list[count++] = cpu;
+            }
+        }
+        if (count == 0) return FALSE;
+        affinity_list_count = count;
+    }
+
+    gAffinity = type;
+    strncpy(affinity_name, policy, sizeof(affinity_name) - 1);
+    return TRUE;
+}
+
+//-------------------------------------------------------------------------------------------------
+//  Current affinity policy.
+//-------------------------------------------------------------------------------------------------
+char *threads_affinity_name(void)
+{
+    return affinity_name;
+}
+
+//-------------------------------------------------------------------------------------------------
+//  Bind the current thread to its cpu according to the affinity policy. thread_number is 0 for
+//  the main search thread.
+//-------------------------------------------------------------------------------------------------
+void threads_bind(int thread_number)
+{
+    int cpus[MAX_CPUS];
+    int count = 0;
+    int nodes = util_numa_nodes();
+
+    switch (gAffinity) {
+    case AFFINITY_NONE:
+        // Undo a previous binding, threads inherit the affinity of the thread that created them.
+        if (!affinity_bound) return;
+        count = util_cpu_list(-1, cpus, MAX_CPUS);
+        util_bind_thread(cpus, count);
+        return;
+    case AFFINITY_COMPACT:
+        for (int node = 0; node < nodes; node++) {
+            count += util_cpu_list(node, &cpus[count], MAX_CPUS - count);
+        }
+        if (count == 0) return;
+        affinity_bound = util_bind_thread(&cpus[thread_number % count], 1) || affinity_bound;
+        return;
+    case AFFINITY_SCATTER:
+        count = util_cpu_list(thread_number % nodes, cpus, MAX_CPUS);
+        if (count == 0) return;
+        affinity_bound = util_bind_thread(&cpus[thread_number / nodes % count], 1) || affinity_bound;
+        return;
+    case AFFINITY_LIST:
+        affinity_bound = util_bind_thread(&affinity_list[thread_number % affinity_list_count], 1) || affinity_bound;
+        return;
+    case AFFINITY_NUMA:
+        affinity_bound = util_numa_bind_thread(thread_number * nodes / MAX(gThreads, 1)) || affinity_bound;
+        return;
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+//  Thread setup, runs in the worker: bind it to its cpu and allocate its data, so memory is placed
+//  (first touch) on the numa node of the thread.
+//-------------------------------------------------------------------------------------------------
+void *threads_setup(void *data)
+{
+    int index = *(int *)data;
+
+    threads_bind(index + 1);
+    thread_data[index] = (GAME *)ALIGNED_ALLOC(64, sizeof(GAME));
+    if (thread_data[index] != NULL) memset(thread_data[index], 0, sizeof(GAME));
+
+    return NULL;
+}
+
+//-------------------------------------------------------------------------------------------------
+//  Create threads data. Additional threads are the thread pool workers, created once here.
 //-------------------------------------------------------------------------------------------------
 void threads_init()
 {
-    if (thread_data != NULL) {
-        ALIGNED_FREE(thread_data);
-        thread_data = NULL;
+    for (int i = 0; i < additional_threads; i++) {
+        if (thread_data[i] != NULL) ALIGNED_FREE(thread_data[i]);
+        thread_data[i] = NULL;
     }
     if (gThreads <= 0) gThreads = 1;
+
+    static int mutex_ready = FALSE;
+    if (!mutex_ready) {
+        MUTEX_INIT(multi_pv_mutex);
+        mutex_ready = TRUE;
+    }
+
+    // The first call saves the process cpus, before any thread is bound.
+    int cpus[MAX_CPUS];
+    util_cpu_list(-1, cpus, MAX_CPUS);
+
     additional_threads = gThreads - 1;
-    if (additional_threads == 0) return;
-    thread_data = (GAME *)ALIGNED_ALLOC(64, sizeof(GAME) * additional_threads);
-    if (thread_data == NULL) {
-        fprintf(stderr, "Error allocating memory for %d additional threads. Running with no paralel search.\n", additional_threads);
+    pool_init(additional_threads);
+    if (pool_workers() != additional_threads) {
+        fprintf(stderr, "Error creating %d additional threads. Running with no paralel search.\n", additional_threads);
         additional_threads = 0;
         return;
     }
     for (int i = 0; i < additional_threads; i++) {
-        memset(&thread_data[i], 0, sizeof(GAME));
+        thread_index[i] = i;
+        pool_start(i, threads_setup, &thread_index[i]);
+    }
+    int allocated = TRUE;
+    for (int i = 0; i < additional_threads; i++) {
+        pool_wait(i);
+        if (thread_data[i] == NULL) allocated = FALSE;
+    }
+    if (!allocated) {
+        fprintf(stderr, "Error allocating memory for %d additional threads. Running with no paralel search.\n", additional_threads);
+        for (int i = 0; i < additional_threads; i++) {
+            if (thread_data[i] != NULL) ALIGNED_FREE(thread_data[i]);
+            thread_data[i] = NULL;
+        }
+        additional_threads = 0;
     }
 }
 
@@ -62,12 +248,34 @@ void *ponder_search(void *game)
     ponder_settings.post_flag = POST_XBOARD;
     ponder_settings.use_book = FALSE;
     ponder_settings.max_nodes = 0;
+    ponder_settings.search_moves_count = 0;
+    ponder_settings.mate = 0;
 
     search_run((GAME *)game, &ponder_settings);
 
     return NULL;
 }
 
+//-------------------------------------------------------------------------------------------------
+//  Copy the root position to a helper thread board: board state, history entries used by
+//  repetition checks (since last capture or pawn move, plus last move) and the root accumulator,
+//  that should be computed, as the first entry of the accumulator stack. Entries before these are
+//  not used during the search.
+//-------------------------------------------------------------------------------------------------
+void copy_root_board(BOARD *target, BOARD *source)
+{
+    int root = source->histply;
+    int first = MAX(0, root - source->fifty_move_rule - 1);
+
+    memcpy(target, source, offsetof(BOARD, history));
+    memcpy(&target->history[first], &source->history[first], sizeof(MOVE_HIST) * (root - first));
+    memcpy(&target->nnue_data[0], &source->nnue_data[source->nnue_ply], sizeof(NNUE_DATA));
+
+    // The accumulator is computed, changes to reach the root are not needed.
+    target->nnue_data[0].changes.count = 0;
+    target->nnue_ply = 0;
+}
+
 //-------------------------------------------------------------------------------------------------
 //  Search preparation and threads coordination
 //-------------------------------------------------------------------------------------------------
@@ -86,11 +294,20 @@ void search_run(GAME *game, SETTINGS *settings)
     game->search.abort = FALSE;
     game->search.nodes = 0;
     game->search.tbhits = 0;
+    game->search.nodes_check = 0;
+    game->search.completed_depth = 0;
+    game->search.multi_pv = MAX(MIN_MULTI_PV, MIN(gMultiPV, MAX_MULTI_PV));
+    game->search.root_exclude_count = 0;
+    game->multi_pv.count = 0;
+    publish_root_exclude(game);
+    memset(&game->search.tt_stats, 0, sizeof(TT_STATS));
 #ifdef TUCANO_COMPOSITION
     game->search.exclude = settings->exclude;
 #endif
 
     game->is_main_thread = TRUE;
+    game->thread_number = 0;
+    threads_bind(0);
 
     //  Try to find a move from book.
     if (game->search.use_book) {
@@ -110,30 +327,39 @@ void search_run(GAME *game, SETTINGS *settings)
     memset(&game->move_order, 0, sizeof(MOVE_ORDER));
     tt_age();
 
+    // Root accumulator, first entry of the accumulator stack (set_ply), used by all threads.
+    nnue_compute_accumulator(&game->board);
+
     //  Multi Thread: copy data to additional threads and start them.
     for (int i = 0; i < additional_threads; i++) {
-        memcpy(&thread_data[i].board, &game->board, sizeof(BOARD));
-		memcpy(&thread_data[i].search, &game->search, sizeof(SEARCH));
-        memcpy(&thread_data[i].move_order, &game->move_order, sizeof(MOVE_ORDER));
-        thread_data[i].is_main_thread = FALSE;
-        thread_data[i].search.post_flag = POST_NONE;
-        thread_data[i].thread_number = i;
-        THREAD_CREATE(thread_data[i].thread_handle, iterative_deepening, &thread_data[i]);
+        copy_root_board(&thread_data[i]->board, &game->board);
+		memcpy(&thread_data[i]->search, &game->search, sizeof(SEARCH));
+        memset(&thread_data[i]->move_order, 0, sizeof(MOVE_ORDER));
+        thread_data[i]->is_main_thread = FALSE;
+        thread_data[i]->search.post_flag = POST_NONE;
+        thread_data[i]->thread_number = i + 1;
+        thread_data[i]->eval_cache = eval_cache_thread(i + 1);
+        helper_lines[i + 1].depth = 0;
+        pool_start(i, iterative_deepening, thread_data[i]);
     }
 
     //  Run main search
     iterative_deepening(game);
 
-	//  Notify additional threads to finish and wait
-    for (int i = 0; i < additional_threads; i++) {
-        thread_data[i].search.abort = TRUE;
-    }
+    //  Notify additional threads to finish and wait
+    search_signal(SIGNAL_STOP);
     for (int i = 0; i < additional_threads; i++) {
-        THREAD_WAIT(thread_data[i].thread_handle);
+        pool_wait(i);
     }
+    game->search.stop_latency = (UINT)(util_get_time_us() - stop_request_time);
+    search_signal_clear(SIGNAL_STOP);
+
+    if (additional_threads > 0 && game->search.multi_pv == 1) select_best_thread(game);
 
     game->search.end_time = util_get_time();
     game->search.elapsed_time = game->search.end_time - game->search.start_time;
+
+    if (gTTStats) post_tt_stats(game);
 }
 
 U64 get_additional_threads_nodes(void)
@@ -141,7 +367,7 @@ U64 get_additional_threads_nodes(void)
     U64     total = 0;
 
     for (int i = 0; i < additional_threads; i++) {
-        total += thread_data[i].search.nodes;
+        total += thread_data[i]->search.nodes;
     }
 
     return total;
@@ -152,12 +378,49 @@ U64 get_additional_threads_tbhits(void)
     U64     total = 0;
 
     for (int i = 0; i < additional_threads; i++) {
-        total += thread_data[i].search.tbhits;
+        total += thread_data[i]->search.tbhits;
     }
 
     return total;
 }
 
+//-------------------------------------------------------------------------------------------------
+//  Transposition table statistics of all threads.
+//-------------------------------------------------------------------------------------------------
+void get_threads_tt_stats(GAME *game, TT_STATS *total)
+{
+    memcpy(total, &game->search.tt_stats, sizeof(TT_STATS));
+
+    for (int i = 0; i < additional_threads; i++) {
+        TT_STATS *stats = &thread_data[i]->search.tt_stats;
+        for (int j = 0; j < 3; j++) total->reads[j] += stats->reads[j];
+        for (int j = 0; j < 4; j++) total->cutoffs[j] += stats->cutoffs[j];
+        for (int j = 0; j < 4; j++) total->saves[j] += stats->saves[j];
+        for (int j = 0; j < 2; j++) total->eval_reads[j] += stats->eval_reads[j];
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+//  Count the legal root moves that are not excluded into root_move_count. Returns the first one,
+//  or MOVE_NONE.
+//-------------------------------------------------------------------------------------------------
+MOVE count_root_moves(GAME *game, int incheck)
+{
+    MOVE_LIST   root;
+    MOVE        move;
+    MOVE        first_move = MOVE_NONE;
+
+    game->search.root_move_count = 0;
+    select_init(&root, game, incheck, MOVE_NONE, FALSE);
+    while ((move = next_move(&root)) != MOVE_NONE) {
+        if (is_pseudo_legal(&game->board, root.pins, move) && !is_root_excluded(game, move)) {
+            if (first_move == MOVE_NONE) first_move = move;
+            game->search.root_move_count++;
+        }
+    }
+    return first_move;
+}
+
 //-------------------------------------------------------------------------------------------------
 //  Main search loop (iterative deepening)
 //-------------------------------------------------------------------------------------------------
@@ -165,6 +428,9 @@ void *iterative_deepening(void *pv_game)
 {
     GAME *game = (GAME *)pv_game;
 
+    game->nnue_param = nnue_thread_param();
+    game->board.nnue_eager = gNnueEager ? game->nnue_param : NULL;
+
     if (game->search.post_flag == POST_DEFAULT) {
         printf("Ply      Nodes  Score Time Principal Variation\n");
     }
@@ -173,16 +439,14 @@ void *iterative_deepening(void *pv_game)
     set_ply(&game->board, 0);
 
     // Count moves at root node (for analyse info)
-    game->search.root_move_count = 0;
-    MOVE_LIST   root;
-    MOVE        move;
+    MOVE first_root_move = count_root_moves(game, incheck);
 
-    select_init(&root, game, incheck, MOVE_NONE, FALSE);
-    while ((move = next_move(&root)) != MOVE_NONE) {
-        if (is_pseudo_legal(&game->board, root.pins, move)) {
-            game->search.root_move_count++;
-        }
+    // When no searchmoves move is legal, all legal moves are searched.
+    if (game->search.root_move_count == 0 && game->search.search_moves_count > 0) {
+        game->search.search_moves_count = 0;
+        first_root_move = count_root_moves(game, incheck);
     }
+    game->search.multi_pv = MIN(game->search.multi_pv, MAX(1, game->search.root_move_count));
 
     //  Start the iterative deepening
     int prev_score = 0;
@@ -193,17 +457,35 @@ void *iterative_deepening(void *pv_game)
         if (!game->is_main_thread && depth > 1 && depth < game->search.max_depth) {
             int count = 0;
             for (int i = 0; i < additional_threads; i++) {
-                if (thread_data[i].search.cur_depth >= depth) count++;
+                if (thread_data[i]->search.cur_depth >= depth) count++;
             }
             if (count > additional_threads / 2) depth++;
         }
 
         game->search.cur_depth = depth;
 
-        int score = search_asp(game, incheck, depth, prev_score);
+        int score = 0;
+        if (game->search.multi_pv > 1 && game->is_main_thread) {
+            score = search_multi_pv(game, incheck, depth);
+        }
+        else {
+            if (game->search.multi_pv > 1) set_root_exclude(game);
+            score = search_asp(game, incheck, depth, prev_score);
+        }
         if (game->search.abort) break;
 
         game->search.best_score = score;
+        game->search.completed_depth = depth;
+        game->completed_pv_size = MAX(1, game->pv_line.size[0]);
+        memcpy(game->completed_pv, game->pv_line.line[0], sizeof(MOVE) * game->completed_pv_size);
+        if (game->search.multi_pv > 1 && !game->is_main_thread) publish_helper_line(game);
+
+        // go mate: a mate in the requested number of moves was found, all threads can stop. It is
+        // only a stop condition, the search is the same as without it.
+        if (game->search.mate && score >= MATE_SCORE - (2 * game->search.mate - 1)) {
+            search_signal(SIGNAL_STOP);
+            break;
+        }
 
         // Verify if score dropped from last iteration.
         if (depth > 4) {
@@ -239,15 +521,236 @@ void *iterative_deepening(void *pv_game)
 
     // collect best and ponder moves
     if (game->is_main_thread) {
-        game->search.best_move = game->pv_line.line[0][0];
-        if (game->pv_line.size[0] > 1) {
-            game->search.ponder_move = game->pv_line.line[0][1];
+        // A stop before the first iteration found a move leaves no line, any legal move is played.
+        if (game->pv_line.line[0][0] == MOVE_NONE && first_root_move != MOVE_NONE) {
+            game->pv_line.line[0][0] = first_root_move;
+            game->pv_line.size[0] = 1;
         }
+        set_best_move(game);
     }
 
+    // Moves made after the search update the accumulators in evaluate.
+    game->board.nnue_eager = NULL;
+
     return NULL;
 }
 
+//-------------------------------------------------------------------------------------------------
+//  Best and ponder moves from the principal variation.
+//-------------------------------------------------------------------------------------------------
+void set_best_move(GAME *game)
+{
+    game->search.best_move = game->pv_line.line[0][0];
+    game->search.ponder_move = game->pv_line.size[0] > 1 ? game->pv_line.line[0][1] : MOVE_NONE;
+}
+
+//-------------------------------------------------------------------------------------------------
+//  Choose the best move among all threads. Each thread votes for the first move of the principal
+//  variation of its last completed iteration, weighted by the depth and its score over the lowest
+//  score. Mate scores win. When a helper wins with another move, its principal variation is copied
+//  to the main thread and posted, so the last line sent matches the best move.
+//-------------------------------------------------------------------------------------------------
+void select_best_thread(GAME *game)
+{
+    GAME    *threads[MAX_THREADS];
+    int     votes[MAX_THREADS];
+    int     count = 0;
+
+    threads[count++] = game;
+    for (int i = 0; i < additional_threads; i++) {
+        if (thread_data[i]->search.completed_depth > 0 && thread_data[i]->completed_pv[0] != MOVE_NONE) {
+            threads[count++] = thread_data[i];
+        }
+    }
+    if (game->search.completed_depth == 0 || game->completed_pv[0] == MOVE_NONE || count == 1) return;
+
+    int min_score = game->search.best_score;
+    for (int i = 1; i < count; i++) {
+        min_score = MIN(min_score, threads[i]->search.best_score);
+    }
+
+    // Votes for the move of each thread, summing threads with the same move.
+    for (int i = 0; i < count; i++) {
+        votes[i] = 0;
+        for (int j = 0; j < count; j++) {
+            if (threads[j]->completed_pv[0] == threads[i]->completed_pv[0]) {
+                votes[i] += (threads[j]->search.best_score - min_score + 14) * threads[j]->search.completed_depth;
+            }
+        }
+    }
+
+    int best = 0;
+    for (int i = 1; i < count; i++) {
+        int score = threads[i]->search.best_score;
+        int best_score = threads[best]->search.best_score;
+        if (is_mate_score(best_score)) {
+            if (score > best_score) best = i;
+        }
+        else if (score >= WIN_SCORE || (score > -WIN_SCORE && votes[i] > votes[best])) {
+            best = i;
+        }
+    }
+
+    GAME *best_thread = threads[best];
+    if (best_thread != game && best_thread->completed_pv[0] != game->search.best_move) {
+        memcpy(game->pv_line.line[0], best_thread->completed_pv, sizeof(MOVE) * best_thread->completed_pv_size);
+        game->pv_line.size[0] = best_thread->completed_pv_size;
+        game->search.best_score = best_thread->search.best_score;
+        set_best_move(game);
+        // The last line sent has to match the best move.
+        post_info(game, game->search.best_score, best_thread->search.completed_depth);
+    }
+
+    if (game->search.post_flag == POST_UCI && gDebug) {
+        char move_string[10];
+        util_get_move_string(game->search.best_move, move_string);
+        printf("info string best move %s from thread %d depth %d score %d votes %d\n", move_string,
+            best_thread->thread_number, best_thread->search.completed_depth, best_thread->search.best_score, votes[best]);
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+//  Multi PV search: the root is searched once for each line, without the moves of previous lines.
+//  Helper lines of the same or higher depth are merged, then lines are sorted by score and the
+//  first one is the principal variation.
+//-------------------------------------------------------------------------------------------------
+int search_multi_pv(GAME *game, int incheck, int depth)
+{
+    MULTI_PV *lines = &game->multi_pv;
+
+    game->search.root_exclude_count = 0;
+    for (int k = 0; k < game->search.multi_pv; k++) {
+        int prev_score = k < lines->count ? lines->score[k] : 0;
+        int score = search_asp(game, incheck, depth, prev_score);
+        if (game->search.abort) {
+            // Keep the first line of this iteration, later lines do not have the best move.
+            if (k > 0) {
+                memcpy(game->pv_line.line[0], lines->line[0], sizeof(MOVE) * lines->size[0]);
+                game->pv_line.size[0] = lines->size[0];
+            }
+            return 0;
+        }
+        lines->size[k] = MAX(1, game->pv_line.size[0]);
+        lines->score[k] = score;
+        memcpy(lines->line[k], game->pv_line.line[0], sizeof(MOVE) * lines->size[k]);
+        game->search.root_exclude[game->search.root_exclude_count++] = lines->line[k][0];
+    }
+    lines->count = game->search.multi_pv;
+    game->search.root_exclude_count = 0;
+
+    if (additional_threads > 0) merge_helper_lines(game, depth);
+
+    // A later line can get a better score due to search instability.
+    for (int i = 1; i < lines->count; i++) {
+        for (int j = i; j > 0 && lines->score[j] > lines->score[j - 1]; j--) {
+            MOVE line[MAX_PLY];
+            int size = lines->size[j];
+            int score = lines->score[j];
+            memcpy(line, lines->line[j], sizeof(MOVE) * size);
+            memcpy(lines->line[j], lines->line[j - 1], sizeof(MOVE) * lines->size[j - 1]);
+            lines->size[j] = lines->size[j - 1];
+            lines->score[j] = lines->score[j - 1];
+            memcpy(lines->line[j - 1], line, sizeof(MOVE) * size);
+            lines->size[j - 1] = size;
+            lines->score[j - 1] = score;
+        }
+    }
+
+    memcpy(game->pv_line.line[0], lines->line[0], sizeof(MOVE) * lines->size[0]);
+    game->pv_line.size[0] = lines->size[0];
+
+    publish_root_exclude(game);
+
+    for (int k = 0; k < lines->count; k++) {
+        post_line(game, lines->score[k], depth, k + 1, lines->line[k], lines->size[k]);
+    }
+
+    return lines->score[0];
+}
+
+//-------------------------------------------------------------------------------------------------
+//  Copy the root moves of the sorted multi pv lines for the helper threads. The main thread
+//  rewrites its lines during the next iteration, so helpers only read this copy.
+//-------------------------------------------------------------------------------------------------
+void publish_root_exclude(GAME *game)
+{
+    MUTEX_LOCK(multi_pv_mutex);
+    for (int i = 0; i < game->multi_pv.count; i++) {
+        root_exclude_moves[i] = game->multi_pv.line[i][0];
+    }
+    root_exclude_moves_count = game->multi_pv.count;
+    MUTEX_UNLOCK(multi_pv_mutex);
+}
+
+//-------------------------------------------------------------------------------------------------
+//  Keep the line of the last completed iteration of a helper, for the main thread multi pv lines.
+//-------------------------------------------------------------------------------------------------
+void publish_helper_line(GAME *game)
+{
+    HELPER_LINE *helper = &helper_lines[game->thread_number];
+
+    MUTEX_LOCK(multi_pv_mutex);
+    memcpy(helper->line, game->completed_pv, sizeof(MOVE) * game->completed_pv_size);
+    helper->size = game->completed_pv_size;
+    helper->score = game->search.best_score;
+    helper->depth = game->search.completed_depth;
+    MUTEX_UNLOCK(multi_pv_mutex);
+}
+
+//-------------------------------------------------------------------------------------------------
+//  Merge the helper lines searched to at least the depth of the main thread lines. A deeper line
+//  for the same root move replaces it, a line for another move replaces the lowest score line
+//  when its score is higher. Lines are sorted after.
+//-------------------------------------------------------------------------------------------------
+void merge_helper_lines(GAME *game, int depth)
+{
+    MULTI_PV *lines = &game->multi_pv;
+    int line_depth[MAX_MULTI_PV];
+
+    for (int k = 0; k < lines->count; k++) line_depth[k] = depth;
+
+    MUTEX_LOCK(multi_pv_mutex);
+    for (int t = 1; t <= additional_threads; t++) {
+        HELPER_LINE *helper = &helper_lines[t];
+        if (helper->depth < depth || helper->line[0] == MOVE_NONE) continue;
+
+        int slot = -1;
+        for (int k = 0; k < lines->count; k++) {
+            if (lines->line[k][0] == helper->line[0]) slot = k;
+        }
+        if (slot == -1) {
+            slot = 0;
+            for (int k = 1; k < lines->count; k++) {
+                if (lines->score[k] < lines->score[slot]) slot = k;
+            }
+            if (helper->score <= lines->score[slot]) continue;
+        }
+        else if (helper->depth <= line_depth[slot]) {
+            continue;
+        }
+        memcpy(lines->line[slot], helper->line, sizeof(MOVE) * helper->size);
+        lines->size[slot] = helper->size;
+        lines->score[slot] = helper->score;
+        line_depth[slot] = helper->depth;
+    }
+    MUTEX_UNLOCK(multi_pv_mutex);
+}
+
+//-------------------------------------------------------------------------------------------------
+//  Helper threads split the multi pv lines: each one searches the root without the moves of the
+//  lines before its own, taken from the last iteration of the main thread.
+//-------------------------------------------------------------------------------------------------
+void set_root_exclude(GAME *game)
+{
+    MUTEX_LOCK(multi_pv_mutex);
+    int count = MIN(game->thread_number % game->search.multi_pv, root_exclude_moves_count);
+    for (int i = 0; i < count; i++) {
+        game->search.root_exclude[i] = root_exclude_moves[i];
+    }
+    MUTEX_UNLOCK(multi_pv_mutex);
+    game->search.root_exclude_count = count;
+}
+
 //-------------------------------------------------------------------------------------------------
 //  Aspiration window search.
 //-------------------------------------------------------------------------------------------------
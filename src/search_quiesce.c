@@ -55,23 +55,33 @@ int quiesce(GAME *game, UINT incheck, int alpha, int beta, int depth)
 
     // transposition table score or move hint
     TT_RECORD tt_record;
-    tt_read(game->board.key, &tt_record);
+    int tt_eval;
+    int tt_result = tt_read(game->board.key, &tt_record, &tt_eval);
+    TT_STATS_COUNT(game, reads, tt_result);
     if (tt_record.data && tt_record.info.depth >= quiesce_depth) {
         score = score_from_tt(tt_record.info.score, game->board.ply);
         if (tt_record.info.flag == TT_EXACT) {
+            TT_STATS_COUNT(game, cutoffs, tt_record.info.flag);
             return score;
         }
         if (score >= beta && tt_record.info.flag == TT_LOWER) {
+            TT_STATS_COUNT(game, cutoffs, tt_record.info.flag);
             return score;
         }
         if (score <= alpha && tt_record.info.flag == TT_UPPER) {
+            TT_STATS_COUNT(game, cutoffs, tt_record.info.flag);
             return score;
         }
     }
     MOVE trans_move = tt_record.info.move;
 
     if (!incheck) {
-        best_score = evaluate(game);
+        best_score = tt_eval;
+        if (best_score == TT_EVAL_NONE) {
+            // Not saved here: stand pat is the hottest path, the evaluation is saved with the node.
+            best_score = evaluate(game);
+            tt_eval = best_score;
+        }
         if (best_score >= beta) {
             return best_score;
         }
@@ -126,7 +136,8 @@ int quiesce(GAME *game, UINT incheck, int alpha, int beta, int depth)
                     tt_record.info.depth = quiesce_depth;
                     tt_record.info.flag = TT_LOWER;
                     tt_record.info.score = score_to_tt(score, ply);
-                    tt_save(game->board.key, &tt_record);
+                    tt_result = tt_save(game->board.key, &tt_record, tt_eval);
+                    TT_STATS_COUNT(game, saves, tt_result);
                     return score;
                 }
                 alpha = score;
@@ -153,7 +164,8 @@ int quiesce(GAME *game, UINT incheck, int alpha, int beta, int depth)
         tt_record.info.flag = TT_UPPER;
         tt_record.info.score = score_to_tt(best_score, ply);
     }
-    tt_save(game->board.key, &tt_record);
+    tt_result = tt_save(game->board.key, &tt_record, tt_eval);
+    TT_STATS_COUNT(game, saves, tt_result);
 
     return best_score;
 }
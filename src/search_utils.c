@@ -42,6 +42,9 @@ void prepare_search(GAME *game, SETTINGS *settings)
     game->search.max_depth = settings->max_depth;
     game->search.is_single_move_time = FALSE;
     game->search.max_nodes = settings->max_nodes;
+    game->search.search_moves_count = settings->search_moves_count;
+    memcpy(game->search.search_moves, settings->search_moves, sizeof(MOVE) * settings->search_moves_count);
+    game->search.mate = settings->mate;
 
     //  Specific time per move
     if (settings->single_move_time > 0) {
@@ -153,25 +156,54 @@ void update_pv(PV_LINE *pv_line, int ply, MOVE move)
     pv_line->size[ply] = pv_line->size[ply + 1];
 }
 
+//-------------------------------------------------------------------------------------------------
+//  Root moves not in the search moves list, or already found by previous multi pv lines, are not
+//  searched.
+//-------------------------------------------------------------------------------------------------
+int is_root_excluded(GAME *game, MOVE move)
+{
+    if (game->search.search_moves_count) {
+        int found = FALSE;
+        for (int i = 0; i < game->search.search_moves_count; i++) {
+            if (game->search.search_moves[i] == move) found = TRUE;
+        }
+        if (!found) return TRUE;
+    }
+    for (int i = 0; i < game->search.root_exclude_count; i++) {
+        if (game->search.root_exclude[i] == move) return TRUE;
+    }
+    return FALSE;
+}
+
 //-------------------------------------------------------------------------------------------------
 //  Check if time for search has ended.
 //-------------------------------------------------------------------------------------------------
 void check_time(GAME *search_data)
 {
+    if (search_signals() & SIGNAL_STOP) {
+        search_data->search.abort = TRUE;
+        return;
+    }
     if (!search_data->is_main_thread) { // check time for main thread only
         return;
     }
-    if (search_data->search.max_nodes) {
-        if (search_data->search.nodes + get_additional_threads_nodes() >= search_data->search.max_nodes) {
+    if (search_data->search.max_nodes && search_data->search.nodes >= search_data->search.nodes_check) {
+        U64 total_nodes = search_data->search.nodes + get_additional_threads_nodes();
+        if (total_nodes >= search_data->search.max_nodes) {
+            search_signal(SIGNAL_STOP);
             search_data->search.abort = TRUE;
             return;
         }
+        // Next check before the threads can reach max_nodes. With one thread it is exact.
+        U64 remaining = (search_data->search.max_nodes - total_nodes) / MAX(gThreads, 1);
+        search_data->search.nodes_check = search_data->search.nodes + MAX(1, MIN(remaining, NODES_CHECK));
     }
     if (search_data->search.nodes & TIME_CHECK) {
         return;
     }
     UINT current_time = util_get_time();
     if (current_time >= search_data->search.extended_finish_time) {
+        search_signal(SIGNAL_STOP);
         search_data->search.abort = TRUE;
     }
 }
@@ -264,6 +296,14 @@ int score_from_tt(int score, int ply)
 //  Display search information on screen.
 //-------------------------------------------------------------------------------------------------
 void post_info(GAME *game, int score, int depth)
+{
+    post_line(game, score, depth, 0, game->pv_line.line[0], game->pv_line.size[0]);
+}
+
+//-------------------------------------------------------------------------------------------------
+//  Display a principal variation. Index is the multi pv line number (from 1), or 0 if not used.
+//-------------------------------------------------------------------------------------------------
+void post_line(GAME *game, int score, int depth, int index, MOVE *line, int size)
 {
     if (game->search.post_flag == POST_NONE) return;
 
@@ -314,10 +354,12 @@ void post_info(GAME *game, int score, int depth)
         printf("info ");
         printf("depth %d ", depth);
         printf("seldepth %d ", MAX(game->board.selective_depth, depth));
+        if (index > 0) printf("multipv %d ", index);
         printf("score %s %d ", score_type, uci_score);
         printf("time %d ", elapsed_milliseconds);
         printf("nodes %" PRIu64 " ", total_node_count);
         printf("nps %" PRIu64 " ", nodes_per_second);
+        printf("hashfull %d ", tt_hashfull());
 #ifdef EGTB_SYZYGY
         printf("tbhits %" PRIu64 " ", total_tbhits);
 #endif
@@ -326,8 +368,8 @@ void post_info(GAME *game, int score, int depth)
 
     // print pv (works for all options above)
     char move_string[20];
-    for (int pvi = 0; pvi < game->pv_line.size[0]; pvi++) {
-        util_get_move_string(game->pv_line.line[0][pvi], move_string);
+    for (int pvi = 0; pvi < size; pvi++) {
+        util_get_move_string(line[pvi], move_string);
         printf(" %s", move_string);
     }
 
@@ -335,6 +377,34 @@ void post_info(GAME *game, int score, int depth)
     fflush(stdout);
 }
 
+//-------------------------------------------------------------------------------------------------
+//  Print transposition table statistics of the search: reads, cutoffs by bound and save results,
+//  and evaluation cache hits.
+//-------------------------------------------------------------------------------------------------
+void post_tt_stats(GAME *game)
+{
+    if (game->search.post_flag == POST_NONE) return;
+
+    TT_STATS stats;
+    get_threads_tt_stats(game, &stats);
+
+    U64 reads = stats.reads[TT_MISS] + stats.reads[TT_HIT] + stats.reads[TT_MISMATCH];
+    U64 saves = stats.saves[TT_SAVE_NEW] + stats.saves[TT_SAVE_UPDATE] + stats.saves[TT_SAVE_REPLACE] + stats.saves[TT_SAVE_REJECT];
+    double read_pct = reads ? 100.0 / reads : 0;
+    double save_pct = saves ? 100.0 / saves : 0;
+
+    char *prefix = game->search.post_flag == POST_UCI ? "info string " : game->search.post_flag == POST_XBOARD ? "# " : "";
+    printf("%stt reads %" PRIu64 " hits %.1f%% misses %.1f%% mismatches %.1f%% hashfull %d\n", prefix, reads,
+        stats.reads[TT_HIT] * read_pct, stats.reads[TT_MISS] * read_pct, stats.reads[TT_MISMATCH] * read_pct, tt_hashfull());
+    printf("%stt cutoffs exact %" PRIu64 " lower %" PRIu64 " upper %" PRIu64 "\n", prefix,
+        stats.cutoffs[TT_EXACT], stats.cutoffs[TT_LOWER], stats.cutoffs[TT_UPPER]);
+    printf("%stt saves %" PRIu64 " new %.1f%% update %.1f%% replace %.1f%% reject %.1f%%\n", prefix, saves,
+        stats.saves[TT_SAVE_NEW] * save_pct, stats.saves[TT_SAVE_UPDATE] * save_pct, stats.saves[TT_SAVE_REPLACE] * save_pct, stats.saves[TT_SAVE_REJECT] * save_pct);
+    U64 eval_reads = stats.eval_reads[0] + stats.eval_reads[1];
+    printf("%seval cache reads %" PRIu64 " hits %.1f%%\n", prefix, eval_reads, eval_reads ? stats.eval_reads[1] * 100.0 / eval_reads : 0);
+    fflush(stdout);
+}
+
 //-------------------------------------------------------------------------------------------------
 //  Init table used during search.
 //-------------------------------------------------------------------------------------------------
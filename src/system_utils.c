@@ -15,6 +15,10 @@
   You can find the GNU General Public License at http://www.gnu.org/licenses/
 -------------------------------------------------------------------------------*/
 
+#if !defined(_WIN32) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE // cpu affinity functions
+#endif
+
 #include "globals.h"
 
 //-------------------------------------------------------------------------------------------------
@@ -37,6 +41,18 @@ UINT util_get_time(void)
     return (unsigned int)((((U64)ft.dwHighDateTime << 32) | ft.dwLowDateTime) / 10000);
 }
 
+//-------------------------------------------------------------------------------------------------
+//  Current time in microseconds, to measure short intervals.
+//-------------------------------------------------------------------------------------------------
+U64 util_get_time_us(void)
+{
+    LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (U64)(counter.QuadPart / frequency.QuadPart * 1000000 + counter.QuadPart % frequency.QuadPart * 1000000 / frequency.QuadPart);
+}
+
 //-------------------------------------------------------------------------------------------------
 //  Sleep
 //-------------------------------------------------------------------------------------------------
@@ -85,12 +101,134 @@ void util_draw_board(BOARD *board)
     printf("         a   b   c   d   e   f   g   h  \n");
 }
 
+//-------------------------------------------------------------------------------------------------
+//  Allocate a large block of memory. Tries large pages, that requires the "lock pages in memory"
+//  privilege, otherwise uses regular pages.
+//-------------------------------------------------------------------------------------------------
+int util_large_alloc(LARGE_MEMORY *memory, size_t size)
+{
+    SIZE_T large_page_size = GetLargePageMinimum();
+
+    if (large_page_size != 0) {
+        size_t alloc_size = (size + large_page_size - 1) / large_page_size * large_page_size;
+        memory->address = VirtualAlloc(NULL, alloc_size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+        if (memory->address != NULL) {
+            memory->size = alloc_size;
+            memory->page_size = large_page_size;
+            memory->type = MEM_LARGE_PAGES;
+            return TRUE;
+        }
+    }
+
+    memory->address = ALIGNED_ALLOC(64, size);
+    memory->size = size;
+    memory->page_size = 4096;
+    memory->type = MEM_DEFAULT;
+    
+    return memory->address != NULL;
+}
+
+//-------------------------------------------------------------------------------------------------
+//  Release memory allocated by util_large_alloc.
+//-------------------------------------------------------------------------------------------------
+void util_large_free(LARGE_MEMORY *memory)
+{
+    if (memory->address == NULL) return;
+    if (memory->type == MEM_LARGE_PAGES)
+        VirtualFree(memory->address, 0, MEM_RELEASE);
+    else
+        ALIGNED_FREE(memory->address);
+    memory->address = NULL;
+}
+
+//-------------------------------------------------------------------------------------------------
+//  Number of NUMA nodes.
+//-------------------------------------------------------------------------------------------------
+int util_numa_nodes(void)
+{
+    ULONG highest_node = 0;
+    if (!GetNumaHighestNodeNumber(&highest_node)) return 1;
+    return (int)highest_node + 1;
+}
+
+//-------------------------------------------------------------------------------------------------
+//  Run current thread on the processors of the NUMA node.
+//-------------------------------------------------------------------------------------------------
+int util_numa_bind_thread(int node)
+{
+    GROUP_AFFINITY affinity;
+    if (!GetNumaNodeProcessorMaskEx((USHORT)node, &affinity)) return FALSE;
+    return SetThreadGroupAffinity(GetCurrentThread(), &affinity, NULL) ? TRUE : FALSE;
+}
+
+//-------------------------------------------------------------------------------------------------
+//  NUMA node of the processor running the current thread.
+//-------------------------------------------------------------------------------------------------
+int util_numa_current_node(void)
+{
+    PROCESSOR_NUMBER processor;
+    USHORT node = 0;
+    GetCurrentProcessorNumberEx(&processor);
+    if (!GetNumaProcessorNodeEx(&processor, &node)) return 0;
+    return (int)node;
+}
+
+//-------------------------------------------------------------------------------------------------
+//  Processors of a NUMA node, or all nodes when node is -1. Numbers are group * 64 + processor.
+//-------------------------------------------------------------------------------------------------
+int util_cpu_list(int node, int *cpus, int max_cpus)
+{
+    int count = 0;
+    int first_node = node < 0 ? 0 : node;
+    int last_node = node < 0 ? util_numa_nodes() - 1 : node;
+
+    for (int n = first_node; n <= last_node; n++) {
+        GROUP_AFFINITY affinity;
+        if (!GetNumaNodeProcessorMaskEx((USHORT)n, &affinity)) continue;
+        for (int bit = 0; bit < 64 && count < max_cpus; bit++) {
+            if (affinity.Mask & ((KAFFINITY)1 << bit)) cpus[count++] = affinity.Group * 64 + bit;
+        }
+    }
+    return count;
+}
+
+//-------------------------------------------------------------------------------------------------
+//  Run current thread on the processors of the list. A thread runs in one processor group, so only
+//  the processors in the group of the first one are used.
+//-------------------------------------------------------------------------------------------------
+int util_bind_thread(int *cpus, int count)
+{
+    GROUP_AFFINITY affinity;
+
+    if (count <= 0) return FALSE;
+    memset(&affinity, 0, sizeof(affinity));
+    affinity.Group = (WORD)(cpus[0] / 64);
+    for (int i = 0; i < count; i++) {
+        if (cpus[i] / 64 == affinity.Group) affinity.Mask |= (KAFFINITY)1 << (cpus[i] % 64);
+    }
+    return SetThreadGroupAffinity(GetCurrentThread(), &affinity, NULL) ? TRUE : FALSE;
+}
+
+//-------------------------------------------------------------------------------------------------
+//  Memory interleave is not available, pages are placed by first touch.
+//-------------------------------------------------------------------------------------------------
+int util_numa_interleave(void *address, size_t size)
+{
+    (void)address; (void)size;
+    return FALSE;
+}
+
 #else
 
 #include <unistd.h>
 #include <errno.h>
 #include <sys/types.h>
 #include <sys/time.h>
+#include <sys/mman.h>
+#ifdef __linux__
+#include <sched.h>
+#include <sys/syscall.h>
+#endif
 
 //-------------------------------------------------------------------------------------------------
 //  Current time
@@ -102,12 +240,22 @@ UINT util_get_time(void)
     return tv.tv_sec * 1000 + tv.tv_usec / 1000;
 }
 
+//-------------------------------------------------------------------------------------------------
+//  Current time in microseconds, to measure short intervals.
+//-------------------------------------------------------------------------------------------------
+U64 util_get_time_us(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (U64)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
 //-------------------------------------------------------------------------------------------------
 //  Sleep
 //-------------------------------------------------------------------------------------------------
 void util_sleep(int milliseconds)
 {
-    sleep(milliseconds);
+    usleep((useconds_t)milliseconds * 1000);
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -130,6 +278,240 @@ void util_draw_board(BOARD *board)
     printf("         a   b   c   d   e   f   g   h  \n");
 }
 
+//-------------------------------------------------------------------------------------------------
+//  Read a number from a system file, e.g. /sys/kernel/mm/transparent_hugepage/hpage_pmd_size.
+//  Field is used for files with "name: value" lines, e.g. /proc/meminfo.
+//-------------------------------------------------------------------------------------------------
+static size_t util_read_system_value(char *file_name, char *field)
+{
+    char    line[256];
+    size_t  value = 0;
+
+    FILE *file = fopen(file_name, "r");
+    if (file == NULL) return 0;
+    while (fgets(line, sizeof(line), file) != NULL) {
+        if (field != NULL && strncmp(line, field, strlen(field))) continue;
+        char *number = field != NULL ? line + strlen(field) : line;
+        value = (size_t)strtoull(number, NULL, 10);
+        break;
+    }
+    fclose(file);
+    return value;
+}
+
+//-------------------------------------------------------------------------------------------------
+//  Allocate a large block of memory. Tries explicit huge pages (MAP_HUGETLB) first, then
+//  transparent huge pages (MADV_HUGEPAGE) and finally regular pages.
+//-------------------------------------------------------------------------------------------------
+int util_large_alloc(LARGE_MEMORY *memory, size_t size)
+{
+    size_t huge_page_size = 2 * 1024 * 1024;
+    size_t alloc_size = (size + huge_page_size - 1) / huge_page_size * huge_page_size;
+
+#ifdef MAP_HUGETLB
+    size_t tlb_page_size = util_read_system_value("/proc/meminfo", "Hugepagesize:") * 1024;
+    if (tlb_page_size != 0) {
+        size_t tlb_size = (size + tlb_page_size - 1) / tlb_page_size * tlb_page_size;
+        memory->address = mmap(NULL, tlb_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (memory->address != MAP_FAILED) {
+            memory->size = tlb_size;
+            memory->page_size = tlb_page_size;
+            memory->type = MEM_HUGE_TLB;
+            return TRUE;
+        }
+    }
+#endif
+
+    memory->address = ALIGNED_ALLOC(huge_page_size, alloc_size);
+    memory->size = alloc_size;
+    memory->page_size = (size_t)sysconf(_SC_PAGESIZE);
+    memory->type = MEM_DEFAULT;
+    if (memory->address == NULL) return FALSE;
+
+#ifdef MADV_HUGEPAGE
+    if (!madvise(memory->address, alloc_size, MADV_HUGEPAGE)) {
+        FILE *file = fopen("/sys/kernel/mm/transparent_hugepage/enabled", "r");
+        if (file != NULL) {
+            char line[256];
+            if (fgets(line, sizeof(line), file) != NULL && strstr(line, "[never]") == NULL) {
+                size_t thp_size = util_read_system_value("/sys/kernel/mm/transparent_hugepage/hpage_pmd_size", NULL);
+                memory->page_size = thp_size != 0 ? thp_size : huge_page_size;
+            }
+            fclose(file);
+        }
+    }
+#endif
+
+    return TRUE;
+}
+
+//-------------------------------------------------------------------------------------------------
+//  Release memory allocated by util_large_alloc.
+//-------------------------------------------------------------------------------------------------
+void util_large_free(LARGE_MEMORY *memory)
+{
+    if (memory->address == NULL) return;
+    if (memory->type == MEM_HUGE_TLB)
+        munmap(memory->address, memory->size);
+    else
+        ALIGNED_FREE(memory->address);
+    memory->address = NULL;
+}
+
+//-------------------------------------------------------------------------------------------------
+//  Number of NUMA nodes, from the "online" list, e.g. "0-1".
+//-------------------------------------------------------------------------------------------------
+int util_numa_nodes(void)
+{
+#ifdef __linux__
+    char    line[256];
+    int     nodes = 1;
+
+    FILE *file = fopen("/sys/devices/system/node/online", "r");
+    if (file == NULL) return 1;
+    if (fgets(line, sizeof(line), file) != NULL) {
+        for (char *range = strtok(line, ",\n"); range != NULL; range = strtok(NULL, ",\n")) {
+            char *last = strchr(range, '-');
+            int node = atoi(last != NULL ? last + 1 : range);
+            if (node + 1 > nodes) nodes = node + 1;
+        }
+    }
+    fclose(file);
+    return nodes;
+#else
+    return 1;
+#endif
+}
+
+//-------------------------------------------------------------------------------------------------
+//  Cpus the process can run on. Saved on the first call, before search threads are bound.
+//-------------------------------------------------------------------------------------------------
+#ifdef __linux__
+cpu_set_t *util_process_cpus(void)
+{
+    static cpu_set_t    process_cpus;
+    static int          loaded = FALSE;
+
+    if (!loaded) {
+        if (sched_getaffinity(0, sizeof(cpu_set_t), &process_cpus) != 0) {
+            CPU_ZERO(&process_cpus);
+            for (int cpu = 0; cpu < CPU_SETSIZE && cpu < sysconf(_SC_NPROCESSORS_ONLN); cpu++) {
+                CPU_SET(cpu, &process_cpus);
+            }
+        }
+        loaded = TRUE;
+    }
+    return &process_cpus;
+}
+#endif
+
+//-------------------------------------------------------------------------------------------------
+//  Cpus of a NUMA node from its "cpulist", e.g. "0-15,32-47", or all cpus when node is -1. Only
+//  cpus available to the process are returned.
+//-------------------------------------------------------------------------------------------------
+int util_cpu_list(int node, int *cpus, int max_cpus)
+{
+#ifdef __linux__
+    char        file_name[256];
+    char        line[4096];
+    cpu_set_t   *process_cpus = util_process_cpus();
+    int         count = 0;
+
+    if (node < 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE && count < max_cpus; cpu++) {
+            if (CPU_ISSET(cpu, process_cpus)) cpus[count++] = cpu;
+        }
+        return count;
+    }
+
+    sprintf(file_name, "/sys/devices/system/node/node%d/cpulist", node);
+    FILE *file = fopen(file_name, "r");
+    if (file == NULL) return node == 0 ? util_cpu_list(-1, cpus, max_cpus) : 0;
+    if (fgets(line, sizeof(line), file) == NULL) line[0] = '\0';
+    fclose(file);
+
+    for (char *range = strtok(line, ",\n"); range != NULL; range = strtok(NULL, ",\n")) {
+        char *last = strchr(range, '-');
+        int first_cpu = atoi(range);
+        int last_cpu = last != NULL ? atoi(last + 1) : first_cpu;
+        for (int cpu = first_cpu; cpu <= last_cpu && cpu < CPU_SETSIZE && count < max_cpus; cpu++) {
+            if (CPU_ISSET(cpu, process_cpus)) cpus[count++] = cpu;
+        }
+    }
+    return count;
+#else
+    (void)node; (void)cpus; (void)max_cpus;
+    return 0;
+#endif
+}
+
+//-------------------------------------------------------------------------------------------------
+//  Run current thread on the cpus of the list.
+//-------------------------------------------------------------------------------------------------
+int util_bind_thread(int *cpus, int count)
+{
+#ifdef __linux__
+    cpu_set_t cpu_set;
+
+    CPU_ZERO(&cpu_set);
+    for (int i = 0; i < count; i++) {
+        if (cpus[i] >= 0 && cpus[i] < CPU_SETSIZE) CPU_SET(cpus[i], &cpu_set);
+    }
+    if (CPU_COUNT(&cpu_set) == 0) return FALSE;
+
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpu_set) == 0;
+#else
+    (void)cpus; (void)count;
+    return FALSE;
+#endif
+}
+
+//-------------------------------------------------------------------------------------------------
+//  Run current thread on the cpus of the NUMA node.
+//-------------------------------------------------------------------------------------------------
+int util_numa_bind_thread(int node)
+{
+    int cpus[MAX_CPUS];
+    return util_bind_thread(cpus, util_cpu_list(node, cpus, MAX_CPUS));
+}
+
+//-------------------------------------------------------------------------------------------------
+//  NUMA node of the cpu running the current thread.
+//-------------------------------------------------------------------------------------------------
+int util_numa_current_node(void)
+{
+#if defined(__linux__) && defined(SYS_getcpu)
+    unsigned cpu = 0;
+    unsigned node = 0;
+    if (syscall(SYS_getcpu, &cpu, &node, NULL) != 0) return 0;
+    return (int)node;
+#else
+    return 0;
+#endif
+}
+
+//-------------------------------------------------------------------------------------------------
+//  Spread the pages of a memory block over all NUMA nodes. Has to be called before the memory is
+//  used (first touch).
+//-------------------------------------------------------------------------------------------------
+int util_numa_interleave(void *address, size_t size)
+{
+#if defined(__linux__) && defined(SYS_mbind)
+    const int       MPOL_INTERLEAVE_MODE = 3;
+    unsigned long   node_mask[16];
+    int             nodes = util_numa_nodes();
+
+    memset(node_mask, 0, sizeof(node_mask));
+    for (int node = 0; node < nodes && node < (int)(sizeof(node_mask) * 8); node++) {
+        node_mask[node / (8 * sizeof(unsigned long))] |= 1UL << (node % (8 * sizeof(unsigned long)));
+    }
+    return syscall(SYS_mbind, address, size, MPOL_INTERLEAVE_MODE, node_mask, sizeof(node_mask) * 8, 0) == 0;
+#else
+    (void)address; (void)size;
+    return FALSE;
+#endif
+}
+
 #endif
 
 //end
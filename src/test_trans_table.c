@@ -39,6 +39,8 @@ void trans_table_test(char *fen, char *desc)
     settings.increment_time = 0;
     settings.use_book = FALSE;
     settings.max_nodes = 0;
+    settings.search_moves_count = 0;
+    settings.mate = 0;
 
     search_run(game, &settings);
 
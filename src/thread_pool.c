@@ -0,0 +1,176 @@
+/*-------------------------------------------------------------------------------
+  tucano is a chess playing engine developed by Alcides Schulz.
+  Copyright (C) 2011-present - Alcides Schulz
+
+  tucano is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  tucano is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You can find the GNU General Public License at http://www.gnu.org/licenses/
+-------------------------------------------------------------------------------*/
+
+#include "globals.h"
+
+//-------------------------------------------------------------------------------------------------
+//  Thread pool. Workers are created by pool_init and wait on a condition until a job is started,
+//  so search threads, table clearing, etc. don't create threads every time.
+//-------------------------------------------------------------------------------------------------
+
+typedef struct s_pool_worker {
+    THREAD_ID       thread_id;
+    MUTEX           mutex;
+    CONDITION       condition;
+    POOL_FUNCTION   function;
+    void            *data;
+    int             busy;
+    int             quit;
+}   POOL_WORKER;
+
+POOL_WORKER *pool = NULL;
+int         pool_size = 0;
+
+//-------------------------------------------------------------------------------------------------
+//  Worker loop: wait for a job, run it and signal when it is done.
+//-------------------------------------------------------------------------------------------------
+void *pool_worker_loop(void *data)
+{
+    POOL_WORKER *worker = (POOL_WORKER *)data;
+
+    MUTEX_LOCK(worker->mutex);
+    while (TRUE) {
+        while (!worker->busy && !worker->quit) {
+            CONDITION_WAIT(worker->condition, worker->mutex);
+        }
+        if (worker->quit) break;
+        MUTEX_UNLOCK(worker->mutex);
+
+        worker->function(worker->data);
+
+        MUTEX_LOCK(worker->mutex);
+        worker->busy = FALSE;
+        CONDITION_BROADCAST(worker->condition);
+    }
+    MUTEX_UNLOCK(worker->mutex);
+
+    return NULL;
+}
+
+//-------------------------------------------------------------------------------------------------
+//  Create the workers. Existing workers are finished first, unless the pool already has that
+//  number. When a thread cannot be started the pool keeps the workers created before it,
+//  pool_workers returns the actual number.
+//-------------------------------------------------------------------------------------------------
+void pool_init(int workers)
+{
+    if (workers == pool_size) return;
+    pool_quit();
+    if (workers <= 0) return;
+
+    pool = (POOL_WORKER *)malloc(sizeof(POOL_WORKER) * workers);
+    if (pool == NULL) {
+        fprintf(stderr, "Error allocating memory for %d pool threads.\n", workers);
+        return;
+    }
+    for (int i = 0; i < workers; i++) {
+        POOL_WORKER *worker = &pool[i];
+        memset(worker, 0, sizeof(POOL_WORKER));
+        MUTEX_INIT(worker->mutex);
+        CONDITION_INIT(worker->condition);
+        if (!THREAD_CREATED(THREAD_CREATE(worker->thread_id, pool_worker_loop, worker))) {
+            fprintf(stderr, "Error creating pool thread %d of %d.\n", i + 1, workers);
+            MUTEX_DESTROY(worker->mutex);
+            CONDITION_DESTROY(worker->condition);
+            break;
+        }
+        pool_size++;
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+//  Finish the workers, they should not be running a job.
+//-------------------------------------------------------------------------------------------------
+void pool_quit(void)
+{
+    for (int i = 0; i < pool_size; i++) {
+        POOL_WORKER *worker = &pool[i];
+        MUTEX_LOCK(worker->mutex);
+        worker->quit = TRUE;
+        CONDITION_BROADCAST(worker->condition);
+        MUTEX_UNLOCK(worker->mutex);
+        THREAD_WAIT(worker->thread_id);
+        MUTEX_DESTROY(worker->mutex);
+        CONDITION_DESTROY(worker->condition);
+    }
+    if (pool != NULL) free(pool);
+    pool = NULL;
+    pool_size = 0;
+}
+
+//-------------------------------------------------------------------------------------------------
+//  Number of workers.
+//-------------------------------------------------------------------------------------------------
+int pool_workers(void)
+{
+    return pool_size;
+}
+
+//-------------------------------------------------------------------------------------------------
+//  Start a job on a worker. The worker should be idle.
+//-------------------------------------------------------------------------------------------------
+void pool_start(int worker_index, POOL_FUNCTION function, void *data)
+{
+    assert(worker_index >= 0 && worker_index < pool_size);
+
+    POOL_WORKER *worker = &pool[worker_index];
+    MUTEX_LOCK(worker->mutex);
+    worker->function = function;
+    worker->data = data;
+    worker->busy = TRUE;
+    CONDITION_BROADCAST(worker->condition);
+    MUTEX_UNLOCK(worker->mutex);
+}
+
+//-------------------------------------------------------------------------------------------------
+//  Wait until the worker finishes its job.
+//-------------------------------------------------------------------------------------------------
+void pool_wait(int worker_index)
+{
+    assert(worker_index >= 0 && worker_index < pool_size);
+
+    POOL_WORKER *worker = &pool[worker_index];
+    MUTEX_LOCK(worker->mutex);
+    while (worker->busy) {
+        CONDITION_WAIT(worker->condition, worker->mutex);
+    }
+    MUTEX_UNLOCK(worker->mutex);
+}
+
+//-------------------------------------------------------------------------------------------------
+//  Run a function for count data items of data_size bytes: item 0 by the calling thread, the
+//  others by the workers, and wait all. Items above the number of workers run in the calling
+//  thread.
+//-------------------------------------------------------------------------------------------------
+void pool_run(int count, POOL_FUNCTION function, void *data, size_t data_size)
+{
+    char *item = (char *)data;
+    int started = MIN(count - 1, pool_size);
+
+    for (int i = 0; i < started; i++) {
+        pool_start(i, function, item + (i + 1) * data_size);
+    }
+    function(item);
+    for (int i = started + 1; i < count; i++) {
+        function(item + i * data_size);
+    }
+    for (int i = 0; i < started; i++) {
+        pool_wait(i);
+    }
+}
+
+//END
@@ -17,27 +17,67 @@
 
 #include "globals.h"
 
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
 //-------------------------------------------------------------------------------------------------
 //  Transposition Table
 //-------------------------------------------------------------------------------------------------
 
+// Entries are grouped in buckets that fill one cache line, so a probe reads a single line.
+#define TT_BUCKET_SIZE  4
+
+// Lockless entry: the key is stored xor'ed with the record data. An entry written by another
+// thread at the same time will not match the key when read, so torn entries are ignored.
+// The high 16 bits of the key word hold the static evaluation and the low 48 bits of the key are
+// verified. The bucket index comes from the high bits of the key, so with the minimum table size
+// (2^17 buckets) all 64 key bits are checked. Entries with only the evaluation have flag
+// TT_EVAL_ONLY and are read as empty.
 typedef struct s_trans_entry {
-    U64         key;
+    U64         key_eval_xor_data;
     TT_RECORD   record;
 }   TT_ENTRY;
 
+#define TT_KEY_MASK         (((U64)1 << 48) - 1)
+#define TT_EVAL_SHIFT       48
+#define TT_EVAL_ONLY        0x00
+#define TT_EVAL_ONLY_DEPTH  (-128)
+
+typedef struct s_trans_bucket {
+    TT_ENTRY    entry[TT_BUCKET_SIZE];
+}   TT_BUCKET;
+
 struct s_hash_structure {
-    TT_ENTRY    *address;
+    TT_BUCKET   *address;
+    LARGE_MEMORY memory;
     size_t      size;
     U64         count;
-    U64         mask;
     U8          age;
 }   hash_table;
 
+// Saved table: header followed by all buckets. Layout version changes when TT_ENTRY or the
+// bucket mapping changes.
+#define TT_FILE_MAGIC       "TUCANOTT"
+#define TT_FILE_VERSION     4
+
+typedef struct s_hash_file_header {
+    char        magic[8];
+    U32         version;
+    U32         entry_size;
+    U32         bucket_entries;
+    U32         age;
+    U64         bucket_count;
+    U64         key_signature;
+}   HASH_FILE_HEADER;
+
 typedef struct s_hash_clear {
-    THREAD_ID   thread_id;
+    int         thread_number;
     void        *address;
     size_t      size;
+    int         numa_node;
+    U64         first_bucket;
+    U64         bucket_count;
 }   HASH_SECTION;
 
 //-------------------------------------------------------------------------------------------------
@@ -46,28 +86,41 @@ typedef struct s_hash_clear {
 void tt_init()
 {
     assert(sizeof(TT_ENTRY) == 16);
+    assert(sizeof(TT_BUCKET) == 64);
 
-    if (hash_table.address != NULL) free(hash_table.address);
+    util_large_free(&hash_table.memory);
+    hash_table.address = NULL;
 
-    size_t size_mb = gHashSize;
-    hash_table.size = 2;
-    while (hash_table.size * 2 <= size_mb) {
-        hash_table.size *= 2;
-    }
-    hash_table.size = hash_table.size * 1024 * 1024;
+    hash_table.size = (size_t)gHashSize * 1024 * 1024;
 
-    hash_table.address = (TT_ENTRY *)malloc(hash_table.size);
-    if (!hash_table.address) {
+    if (!util_large_alloc(&hash_table.memory, hash_table.size)) {
         fprintf(stderr, "no memory for transposition table, hash=%d !", gHashSize);
         exit(-1);
     }
+    hash_table.address = (TT_BUCKET *)hash_table.memory.address;
+
+    // Pages are spread over the nodes before they are touched by tt_clear.
+    if (gNumaHash && util_numa_nodes() > 1) {
+        util_numa_interleave(hash_table.memory.address, hash_table.memory.size);
+    }
 
-    hash_table.count = hash_table.size / sizeof(TT_ENTRY);
-    hash_table.mask = hash_table.count - 1;
+    hash_table.count = hash_table.size / sizeof(TT_BUCKET);
 
     tt_clear();
 }
 
+//-------------------------------------------------------------------------------------------------
+//  Describe the memory used by the table, e.g. "hash 64 MB, 2048 KB pages".
+//-------------------------------------------------------------------------------------------------
+void tt_memory_info(char *string)
+{
+    char *page_type = hash_table.memory.type == MEM_HUGE_TLB ? " (hugetlb)" : hash_table.memory.type == MEM_LARGE_PAGES ? " (large pages)" : "";
+    sprintf(string, "hash %zu MB, %zu KB pages%s", hash_table.size / (1024 * 1024), hash_table.memory.page_size / 1024, page_type);
+    if (gNumaHash && util_numa_nodes() > 1) {
+        sprintf(string + strlen(string), ", interleaved on %d numa nodes", util_numa_nodes());
+    }
+}
+
 //-------------------------------------------------------------------------------------------------
 //  Increment table age field.
 //-------------------------------------------------------------------------------------------------
@@ -77,12 +130,22 @@ void tt_age(void)
 }
 
 //-------------------------------------------------------------------------------------------------
-//  Clear table section by thread when running multi-thread
+//  Clear table section by thread when running multi-thread. With a numa node the thread runs on
+//  that node while clearing, then gets back the binding of its search thread (-1 is the caller).
 //-------------------------------------------------------------------------------------------------
 void *tt_clear_section(void *data)
 {
     HASH_SECTION *section = (HASH_SECTION *)data;
+    if (section->numa_node == -1) {
+        memset(section->address, 0, section->size);
+        return NULL;
+    }
+    util_numa_bind_thread(section->numa_node);
     memset(section->address, 0, section->size);
+
+    int cpus[MAX_CPUS];
+    util_bind_thread(cpus, util_cpu_list(-1, cpus, MAX_CPUS));
+    if (section->thread_number != -1) threads_bind(section->thread_number);
     return NULL;
 }
 
@@ -91,58 +154,419 @@ void *tt_clear_section(void *data)
 //-------------------------------------------------------------------------------------------------
 void tt_clear(void)
 {
-    HASH_SECTION *sections = (HASH_SECTION *)malloc(sizeof(HASH_SECTION) * gThreads);
+    // With numa hash each node clears (first touch) its own part of the table.
+    int numa_nodes = gNumaHash ? util_numa_nodes() : 1;
+    int section_count = MAX(gThreads, numa_nodes);
+
+    HASH_SECTION *sections = (HASH_SECTION *)malloc(sizeof(HASH_SECTION) * section_count);
     if (sections ==  NULL) {
         fprintf(stderr, "cannot allocate memory for tt_clear().sections: gHashSize: %d,  gThreads=%d\n", gHashSize, gThreads);
         exit(-1);
     }
-    size_t section_size = hash_table.size / gThreads;
-    size_t section_entries = section_size / sizeof(TT_ENTRY);
-    sections[0].address = hash_table.address;
-    sections[0].size = section_size;
-    tt_clear_section(&sections[0]);
-    if (gThreads > 1) {
-        for (int i = 1; i < gThreads; i++) {
-            sections[i].address = hash_table.address + i * section_entries;
-            sections[i].size = section_size;
-            THREAD_CREATE(sections[i].thread_id, tt_clear_section, &sections[i]);
+    for (int i = 0; i < section_count; i++) {
+        U64 first_bucket = hash_table.count * i / section_count;
+        U64 last_bucket = hash_table.count * (i + 1) / section_count;
+        sections[i].address = hash_table.address + first_bucket;
+        sections[i].size = (size_t)(last_bucket - first_bucket) * sizeof(TT_BUCKET);
+        sections[i].numa_node = numa_nodes > 1 ? i * numa_nodes / section_count : -1;
+        sections[i].first_bucket = first_bucket;
+        sections[i].bucket_count = hash_table.count;
+        // pool_run gives item i to worker i - 1, which runs search thread i. Others run in the caller.
+        sections[i].thread_number = i > 0 && i <= pool_workers() ? i : -1;
+    }
+    pool_run(section_count, tt_clear_section, sections, sizeof(HASH_SECTION));
+    free(sections);
+    hash_table.age = 0;
+}
+
+//-------------------------------------------------------------------------------------------------
+//  Replacement value of an entry: deeper entries from the current search are kept. Entries with
+//  only the evaluation have the lowest value.
+//-------------------------------------------------------------------------------------------------
+int tt_entry_value(TT_RECORD *record)
+{
+    if (record->info.flag == TT_EVAL_ONLY) return INT_MIN;
+    int age_distance = (hash_table.age - record->info.age) & 0x3F;
+    return record->info.depth - 8 * age_distance + (record->info.flag == TT_EXACT ? 2 : 0);
+}
+
+//-------------------------------------------------------------------------------------------------
+//  Bucket for a key: the key is mapped to [0, count) with the high 64 bits of key * count, so the
+//  table can have any number of buckets.
+//-------------------------------------------------------------------------------------------------
+U64 tt_bucket_index(U64 key, U64 count)
+{
+#if defined(__SIZEOF_INT128__)
+    return (U64)(((unsigned __int128)key * count) >> 64);
+#elif defined(_MSC_VER) && defined(_WIN64)
+    return __umulh(key, count);
+#else
+    U64 key_lo = (U32)key, key_hi = key >> 32;
+    U64 count_lo = (U32)count, count_hi = count >> 32;
+    U64 middle = key_hi * count_lo + ((key_lo * count_lo) >> 32);
+    U64 middle2 = key_lo * count_hi + (U32)middle;
+    return key_hi * count_hi + (middle >> 32) + (middle2 >> 32);
+#endif
+}
+
+TT_BUCKET *tt_bucket(U64 key)
+{
+    return hash_table.address + tt_bucket_index(key, hash_table.count);
+}
+
+//-------------------------------------------------------------------------------------------------
+//  Rebuild the full key of an entry from its verified low bits and the index of the bucket it is
+//  stored in. The index is increasing with the high bits, so the search starts at the lowest value
+//  they can have. Returns FALSE when no key maps to the bucket.
+//-------------------------------------------------------------------------------------------------
+int tt_rebuild_key(U64 low_key, U64 index, U64 count, U64 *key)
+{
+    for (U64 high = index * ((U64)1 << (64 - TT_EVAL_SHIFT)) / count; high >> (64 - TT_EVAL_SHIFT) == 0; high++) {
+        U64 bucket_index = tt_bucket_index((high << TT_EVAL_SHIFT) | low_key, count);
+        if (bucket_index == index) {
+            *key = (high << TT_EVAL_SHIFT) | low_key;
+            return TRUE;
         }
-        for (int i = 1; i < gThreads; i++) {
-            THREAD_WAIT(sections[i].thread_id);
+        if (bucket_index > index) break;
+    }
+    return FALSE;
+}
+
+//-------------------------------------------------------------------------------------------------
+//  Move the entries of an old table section to the current table, keeping their age. The high key
+//  bits are not stored, they are rebuilt from the old bucket index. When the bucket is full the
+//  entry with lowest value is replaced. Threads can write the same bucket at
+//  the same time: a torn entry fails the key check and is treated as empty.
+//-------------------------------------------------------------------------------------------------
+void *tt_rehash_section(void *data)
+{
+    HASH_SECTION *section = (HASH_SECTION *)data;
+    TT_BUCKET *old_bucket = (TT_BUCKET *)section->address;
+    size_t old_count = section->size / sizeof(TT_BUCKET);
+
+    for (size_t b = 0; b < old_count; b++) {
+        for (int i = 0; i < TT_BUCKET_SIZE; i++) {
+            TT_RECORD record;
+            record.data = old_bucket[b].entry[i].record.data;
+            if (record.data == 0) continue;
+            U64 key_eval = old_bucket[b].entry[i].key_eval_xor_data ^ record.data;
+            U64 key;
+            if (!tt_rebuild_key(key_eval & TT_KEY_MASK, section->first_bucket + b, section->bucket_count, &key)) continue;
+
+            TT_BUCKET *bucket = tt_bucket(key);
+            TT_ENTRY *hash_entry = NULL;
+            int lowest_value = tt_entry_value(&record);
+            for (int j = 0; j < TT_BUCKET_SIZE; j++) {
+                TT_RECORD entry_record;
+                entry_record.data = bucket->entry[j].record.data;
+                if (entry_record.data == 0) {
+                    hash_entry = &bucket->entry[j];
+                    break;
+                }
+                if (tt_entry_value(&entry_record) < lowest_value) {
+                    hash_entry = &bucket->entry[j];
+                    lowest_value = tt_entry_value(&entry_record);
+                }
+            }
+            if (hash_entry != NULL) {
+                hash_entry->key_eval_xor_data = key_eval ^ record.data;
+                hash_entry->record.data = record.data;
+            }
         }
     }
+    return NULL;
+}
+
+//-------------------------------------------------------------------------------------------------
+//  Change the table size to gHashSize keeping the content. The new table is allocated and each
+//  thread moves the entries of a slice of the old table, then the old table is released.
+//  Returns FALSE when there is no memory for the new table, the old table is kept.
+//-------------------------------------------------------------------------------------------------
+int tt_resize(void)
+{
+    if (hash_table.address == NULL) {
+        tt_init();
+        return TRUE;
+    }
+
+    struct s_hash_structure old_table = hash_table;
+    LARGE_MEMORY memory;
+
+    if (!util_large_alloc(&memory, (size_t)gHashSize * 1024 * 1024)) {
+        gHashSize = (S32)(old_table.size / (1024 * 1024));
+        return FALSE;
+    }
+    if (gNumaHash && util_numa_nodes() > 1) {
+        util_numa_interleave(memory.address, memory.size);
+    }
+
+    hash_table.memory = memory;
+    hash_table.address = (TT_BUCKET *)memory.address;
+    hash_table.size = (size_t)gHashSize * 1024 * 1024;
+    hash_table.count = hash_table.size / sizeof(TT_BUCKET);
+    tt_clear();
+    hash_table.age = old_table.age;
+
+    HASH_SECTION *sections = (HASH_SECTION *)malloc(sizeof(HASH_SECTION) * gThreads);
+    if (sections == NULL) {
+        fprintf(stderr, "cannot allocate memory for tt_resize().sections: gHashSize: %d,  gThreads=%d\n", gHashSize, gThreads);
+        exit(-1);
+    }
+    for (int i = 0; i < gThreads; i++) {
+        U64 first_bucket = old_table.count * i / gThreads;
+        U64 last_bucket = old_table.count * (i + 1) / gThreads;
+        sections[i].address = old_table.address + first_bucket;
+        sections[i].size = (size_t)(last_bucket - first_bucket) * sizeof(TT_BUCKET);
+        sections[i].numa_node = -1;
+        sections[i].thread_number = -1;
+        sections[i].first_bucket = first_bucket;
+        sections[i].bucket_count = old_table.count;
+    }
+    pool_run(gThreads, tt_rehash_section, sections, sizeof(HASH_SECTION));
     free(sections);
-    hash_table.age = 0;
+
+    util_large_free(&old_table.memory);
+
+    return TRUE;
+}
+
+//-------------------------------------------------------------------------------------------------
+//  Start loading the bucket of a key into the cache, before it is read.
+//-------------------------------------------------------------------------------------------------
+void tt_prefetch(U64 key)
+{
+#if defined(_MSC_VER)
+    _mm_prefetch((char *)tt_bucket(key), _MM_HINT_T0);
+#else
+    __builtin_prefetch(tt_bucket(key));
+#endif
+}
+
+//-------------------------------------------------------------------------------------------------
+//  Read entry for current boad key. Eval receives the static evaluation of the position, or
+//  TT_EVAL_NONE when it is not stored.
+//-------------------------------------------------------------------------------------------------
+int tt_read(U64 key, TT_RECORD *record, int *eval)
+{
+    TT_BUCKET *bucket = tt_bucket(key);
+    int result = TT_MISMATCH;
+    key &= TT_KEY_MASK;
+    for (int i = 0; i < TT_BUCKET_SIZE; i++) {
+        U64 data = bucket->entry[i].record.data;
+        U64 key_eval = bucket->entry[i].key_eval_xor_data ^ data;
+        if ((key_eval & TT_KEY_MASK) == key && data != 0) {
+            *eval = (S16)(U16)(key_eval >> TT_EVAL_SHIFT);
+            record->data = data;
+            if (record->info.flag != TT_EVAL_ONLY) return TT_HIT;
+            record->data = 0;
+            return TT_MISS;
+        }
+        if (data == 0) result = TT_MISS;
+    }
+    *eval = TT_EVAL_NONE;
+    record->data = 0;
+    return result;
 }
 
 //-------------------------------------------------------------------------------------------------
-//  Read entry for current boad key
+//  Table usage in permill: entries from current search in the first 1000 buckets. Entries with
+//  only the evaluation are not counted, they are read as empty.
 //-------------------------------------------------------------------------------------------------
-void tt_read(U64 key, TT_RECORD *record)
+int tt_hashfull(void)
 {
-    TT_ENTRY *hash_entry = hash_table.address + (key & hash_table.mask);
-    record->data = (hash_entry->key == key) ? hash_entry->record.data : 0;
+    U64 sample = MIN(hash_table.count, 1000);
+    int used = 0;
+    for (U64 b = 0; b < sample; b++) {
+        for (int i = 0; i < TT_BUCKET_SIZE; i++) {
+            TT_RECORD record;
+            record.data = hash_table.address[b].entry[i].record.data;
+            if (record.data != 0 && record.info.flag != TT_EVAL_ONLY && record.info.age == (hash_table.age & 0x3F)) used++;
+        }
+    }
+    return (int)(used * 1000 / (sample * TT_BUCKET_SIZE));
 }
 
 //-------------------------------------------------------------------------------------------------
-//  Save entry for current boad key
+//  Find the slot to save a key: the slot with the same key, or an empty one, otherwise the entry
+//  with lowest value in the bucket. Current receives the slot content.
 //-------------------------------------------------------------------------------------------------
-void tt_save(U64 key, TT_RECORD *record)
+TT_ENTRY *tt_find_slot(U64 key, TT_RECORD *current, int *same_key)
 {
-    TT_ENTRY *hash_entry = hash_table.address + (key & hash_table.mask);
+    TT_BUCKET *bucket = tt_bucket(key);
+    TT_ENTRY *hash_entry = &bucket->entry[0];
 
-    if (hash_entry->key == key 
-    || hash_entry->record.info.depth <= record->info.depth
-    || hash_entry->record.info.age != hash_table.age) {
-        TT_ENTRY new_entry;
-        new_entry.key = key;
-        new_entry.record.data = record->data;
-        new_entry.record.info.age = hash_table.age;
-        if (hash_entry->key == key && new_entry.record.info.move == MOVE_NONE) {
-            new_entry.record.info.move = hash_entry->record.info.move;
+    key &= TT_KEY_MASK;
+    *same_key = FALSE;
+    current->data = hash_entry->record.data;
+    for (int i = 0; i < TT_BUCKET_SIZE; i++) {
+        TT_ENTRY *entry = &bucket->entry[i];
+        TT_RECORD entry_record;
+        entry_record.data = entry->record.data;
+        if (((entry->key_eval_xor_data ^ entry_record.data) & TT_KEY_MASK) == key || entry_record.data == 0) {
+            hash_entry = entry;
+            current->data = entry_record.data;
+            *same_key = entry_record.data != 0;
+            break;
+        }
+        if (tt_entry_value(&entry_record) < tt_entry_value(current)) {
+            hash_entry = entry;
+            current->data = entry_record.data;
         }
-        *hash_entry = new_entry;
     }
+    return hash_entry;
+}
+
+//-------------------------------------------------------------------------------------------------
+//  Save entry for current boad key, with the static evaluation or TT_EVAL_NONE.
+//  Uses the slot with the same key, or an empty one, otherwise replaces the entry with lowest
+//  value in the bucket. Deeper entries from the current search are not replaced.
+//-------------------------------------------------------------------------------------------------
+int tt_save(U64 key, TT_RECORD *record, int eval)
+{
+    TT_RECORD current;
+    int same_key;
+
+    TT_ENTRY *hash_entry = tt_find_slot(key, &current, &same_key);
+    key &= TT_KEY_MASK;
+    if (eval < TT_EVAL_NONE || eval > MAX_SCORE) eval = TT_EVAL_NONE;
+
+    if (same_key
+    || current.info.depth <= record->info.depth
+    || current.info.age != (hash_table.age & 0x3F)) {
+        TT_RECORD new_record;
+        new_record.data = record->data;
+        new_record.info.age = hash_table.age;
+        if (same_key && new_record.info.move == MOVE_NONE) {
+            new_record.info.move = current.info.move;
+        }
+        U16 stored_eval = (U16)eval;
+        if (same_key && eval == TT_EVAL_NONE) {
+            stored_eval = (U16)((hash_entry->key_eval_xor_data ^ current.data) >> TT_EVAL_SHIFT);
+        }
+        hash_entry->key_eval_xor_data = (key | ((U64)stored_eval << TT_EVAL_SHIFT)) ^ new_record.data;
+        hash_entry->record.data = new_record.data;
+        return same_key ? TT_SAVE_UPDATE : current.data == 0 ? TT_SAVE_NEW : TT_SAVE_REPLACE;
+    }
+    return TT_SAVE_REJECT;
+}
+
+//-------------------------------------------------------------------------------------------------
+//  Save the static evaluation of a position. The search data of an entry with the same key is
+//  kept, otherwise an entry with only the evaluation is saved if the slot is empty or has only an
+//  evaluation. Entries from previous searches keep their bounds and moves.
+//-------------------------------------------------------------------------------------------------
+void tt_save_eval(U64 key, int eval)
+{
+    TT_RECORD current;
+    int same_key;
+
+    if (eval <= TT_EVAL_NONE || eval > MAX_SCORE) return;
+
+    TT_ENTRY *hash_entry = tt_find_slot(key, &current, &same_key);
+    key = (key & TT_KEY_MASK) | ((U64)(U16)eval << TT_EVAL_SHIFT);
+
+    if (same_key) {
+        hash_entry->key_eval_xor_data = key ^ current.data;
+        return;
+    }
+    if (current.data == 0 || current.info.flag == TT_EVAL_ONLY) {
+        TT_RECORD new_record;
+        new_record.data = 0;
+        new_record.info.depth = TT_EVAL_ONLY_DEPTH;
+        new_record.info.flag = TT_EVAL_ONLY;
+        new_record.info.age = hash_table.age;
+        hash_entry->key_eval_xor_data = key ^ new_record.data;
+        hash_entry->record.data = new_record.data;
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+//  Fill the header that describes the current table.
+//-------------------------------------------------------------------------------------------------
+void tt_file_header(HASH_FILE_HEADER *header)
+{
+    memset(header, 0, sizeof(HASH_FILE_HEADER));
+    memcpy(header->magic, TT_FILE_MAGIC, sizeof(header->magic));
+    header->version = TT_FILE_VERSION;
+    header->entry_size = sizeof(TT_ENTRY);
+    header->bucket_entries = TT_BUCKET_SIZE;
+    header->age = hash_table.age;
+    header->bucket_count = hash_table.count;
+    header->key_signature = zk_signature();
+}
+
+//-------------------------------------------------------------------------------------------------
+//  Save table content and age to a file. Returns NULL when saved, or the error description.
+//-------------------------------------------------------------------------------------------------
+char *tt_save_file(char *file_name)
+{
+    HASH_FILE_HEADER header;
+
+    tt_file_header(&header);
+
+    FILE *file = fopen(file_name, "wb");
+    if (file == NULL) return "cannot create file";
+
+    int saved = fwrite(&header, sizeof(HASH_FILE_HEADER), 1, file) == 1
+             && fwrite(hash_table.address, sizeof(TT_BUCKET), hash_table.count, file) == hash_table.count;
+
+    if (fclose(file) != 0) saved = FALSE;
+
+    return saved ? NULL : "error writing file";
+}
+
+//-------------------------------------------------------------------------------------------------
+//  Load table content and age from a file created by tt_save_file. The table is resized to the
+//  size in the file. Files with other entry layout or key schema are rejected.
+//  Returns NULL when loaded, or the error description.
+//-------------------------------------------------------------------------------------------------
+char *tt_load_file(char *file_name)
+{
+    HASH_FILE_HEADER header;
+    HASH_FILE_HEADER current;
+
+    FILE *file = fopen(file_name, "rb");
+    if (file == NULL) return "cannot open file";
+
+    if (fread(&header, sizeof(HASH_FILE_HEADER), 1, file) != 1) {
+        fclose(file);
+        return "file too short";
+    }
+
+    tt_file_header(&current);
+    char *error = NULL;
+    if (memcmp(header.magic, current.magic, sizeof(header.magic)))
+        error = "not a hash file";
+    else if (header.version != current.version || header.entry_size != current.entry_size || header.bucket_entries != current.bucket_entries)
+        error = "entry layout does not match";
+    else if (header.key_signature != current.key_signature)
+        error = "key schema does not match";
+    else {
+        // Size must be one the table can have: whole MB, within the hash limits.
+        U64 size_mb = header.bucket_count * sizeof(TT_BUCKET) / (1024 * 1024);
+        if (header.bucket_count * sizeof(TT_BUCKET) != size_mb * 1024 * 1024 || size_mb < MIN_HASH_SIZE || size_mb > MAX_HASH_SIZE)
+            error = "invalid table size";
+    }
+    if (error != NULL) {
+        fclose(file);
+        return error;
+    }
+
+    if (header.bucket_count != hash_table.count) {
+        gHashSize = (S32)(header.bucket_count * sizeof(TT_BUCKET) / (1024 * 1024));
+        tt_init();
+    }
+
+    if (fread(hash_table.address, sizeof(TT_BUCKET), hash_table.count, file) != hash_table.count) {
+        fclose(file);
+        tt_clear();
+        return "file too short";
+    }
+    fclose(file);
+
+    hash_table.age = (U8)header.age;
+
+    return NULL;
 }
 
 //END
@@ -509,6 +509,8 @@ int is_only_one_mate_move(GAME *game, int mate_in, MOVE mate_move)
     settings.post_flag = POST_NONE;
     settings.use_book = FALSE;
     settings.max_nodes = 0;
+    settings.search_moves_count = 0;
+    settings.mate = 0;
 #ifdef TUCANO_COMPOSITION
     settings.exclude = mate_move;
 #else
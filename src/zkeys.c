@@ -391,4 +391,29 @@ U64 zk_square(int color, int piece, int square)
     return square_keys[color][piece][square];
 }
 
+//-------------------------------------------------------------------------------------------------
+//    Signature of all keys. Identifies the key schema of saved hash tables.
+//-------------------------------------------------------------------------------------------------
+U64 zk_signature(void)
+{
+    U64 signature = color_key;
+
+    for (int color = 0; color < 2; color++) {
+        for (int piece = 0; piece < 7; piece++) {
+            for (int square = 0; square < 64; square++) {
+                signature = ((signature << 1) | (signature >> 63)) ^ square_keys[color][piece][square];
+            }
+        }
+        for (int flag = 0; flag < 2; flag++) {
+            signature = ((signature << 1) | (signature >> 63)) ^ king_side_castle_keys[color][flag];
+            signature = ((signature << 1) | (signature >> 63)) ^ queen_side_castle_keys[color][flag];
+        }
+    }
+    for (int square = 0; square < 64; square++) {
+        signature = ((signature << 1) | (signature >> 63)) ^ en_passant_keys[square];
+    }
+
+    return signature;
+}
+
 //END